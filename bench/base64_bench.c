@@ -0,0 +1,152 @@
+// Base64编解码吞吐量基准：对比原来的逐字符if分支实现、查表标量实现和SIMD内核
+// 用法: build/bench/base64_bench [MB]
+#include "base64.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DEFAULT_MB 8
+#define MIN_SECONDS 0.5
+
+// 优化前的实现，作为对比基线
+static const char legacy_chars[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static void legacy_encode(const unsigned char* input, size_t input_len, char* output, size_t* output_len) {
+    size_t i, j;
+    *output_len = 4 * ((input_len + 2) / 3);
+
+    for (i = 0, j = 0; i < input_len;) {
+        unsigned int octet_a = i < input_len ? input[i++] : 0;
+        unsigned int octet_b = i < input_len ? input[i++] : 0;
+        unsigned int octet_c = i < input_len ? input[i++] : 0;
+        unsigned int triple = (octet_a << 16) + (octet_b << 8) + octet_c;
+
+        output[j++] = legacy_chars[(triple >> 18) & 0x3F];
+        output[j++] = legacy_chars[(triple >> 12) & 0x3F];
+        output[j++] = legacy_chars[(triple >> 6) & 0x3F];
+        output[j++] = legacy_chars[triple & 0x3F];
+    }
+    if (input_len % 3 == 1) {
+        output[*output_len - 1] = '=';
+        output[*output_len - 2] = '=';
+    } else if (input_len % 3 == 2) {
+        output[*output_len - 1] = '=';
+    }
+    output[*output_len] = '\0';
+}
+
+static int legacy_index(char c) {
+    if (c >= 'A' && c <= 'Z') return c - 'A';
+    if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+    if (c >= '0' && c <= '9') return c - '0' + 52;
+    if (c == '+') return 62;
+    if (c == '/') return 63;
+    return -1;
+}
+
+static void legacy_decode(const char* input, size_t input_len, unsigned char* output, size_t* output_len) {
+    size_t i, j;
+    *output_len = input_len / 4 * 3;
+    if (input[input_len - 1] == '=') (*output_len)--;
+    if (input[input_len - 2] == '=') (*output_len)--;
+
+    for (i = 0, j = 0; i < input_len;) {
+        unsigned int a = input[i] == '=' ? 0 : legacy_index(input[i]); i++;
+        unsigned int b = input[i] == '=' ? 0 : legacy_index(input[i]); i++;
+        unsigned int c = input[i] == '=' ? 0 : legacy_index(input[i]); i++;
+        unsigned int d = input[i] == '=' ? 0 : legacy_index(input[i]); i++;
+        unsigned int triple = (a << 18) + (b << 12) + (c << 6) + d;
+
+        if (j < *output_len) output[j++] = (triple >> 16) & 0xFF;
+        if (j < *output_len) output[j++] = (triple >> 8) & 0xFF;
+        if (j < *output_len) output[j++] = triple & 0xFF;
+    }
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+typedef struct {
+    const unsigned char* raw;
+    size_t raw_len;
+    char* encoded;
+    size_t encoded_len;
+    unsigned char* decoded;
+} bench_data_t;
+
+// 重复运行直到累计至少MIN_SECONDS，返回GB/s(按原始数据字节数计)
+static double run(bench_data_t* data, int legacy, int encode) {
+    size_t out_len = 0;
+    int rounds = 0;
+    double start = now_seconds(), elapsed = 0;
+
+    do {
+        if (encode && legacy) legacy_encode(data->raw, data->raw_len, data->encoded, &out_len);
+        else if (encode) base64_encode(data->raw, data->raw_len, data->encoded, &out_len);
+        else if (legacy) legacy_decode(data->encoded, data->encoded_len, data->decoded, &out_len);
+        else base64_decode(data->encoded, data->encoded_len, data->decoded, &out_len);
+        rounds++;
+        elapsed = now_seconds() - start;
+    } while (elapsed < MIN_SECONDS);
+
+    return (double)data->raw_len * rounds / elapsed / 1e9;
+}
+
+int main(int argc, char* argv[]) {
+    size_t mb = argc > 1 ? (size_t)atoi(argv[1]) : DEFAULT_MB;
+    if (mb == 0) mb = DEFAULT_MB;
+
+    bench_data_t data;
+    data.raw_len = mb * 1024 * 1024 + 1;  // 带一个余数字节，覆盖填充路径
+    unsigned char* raw = malloc(data.raw_len);
+    data.encoded = malloc(data.raw_len / 3 * 4 + 8);
+    data.decoded = malloc(data.raw_len + 32);
+    if (!raw || !data.encoded || !data.decoded) {
+        fprintf(stderr, "内存不足\n");
+        return 1;
+    }
+
+    srand(12138);
+    for (size_t i = 0; i < data.raw_len; i++) raw[i] = rand() & 0xFF;
+    data.raw = raw;
+
+    // 参考结果用原实现生成，各实现的输出必须与之一致
+    char* expected = malloc(data.raw_len / 3 * 4 + 8);
+    legacy_encode(raw, data.raw_len, expected, &data.encoded_len);
+
+    printf("输入: %zu字节原始数据 / %zu字节base64\n", data.raw_len, data.encoded_len);
+    printf("%-8s %12s %12s\n", "impl", "encode GB/s", "decode GB/s");
+    printf("%-8s %12.3f %12.3f\n", "legacy", run(&data, 1, 1), run(&data, 1, 0));
+
+    const base64_impl_t impls[] = { BASE64_IMPL_SCALAR, BASE64_IMPL_SSE41, BASE64_IMPL_AVX2 };
+    int failed = 0;
+    for (size_t k = 0; k < sizeof(impls) / sizeof(impls[0]); k++) {
+        if (!base64_set_impl(impls[k])) continue;
+
+        size_t len = 0;
+        base64_encode(raw, data.raw_len, data.encoded, &len);
+        int ok = len == data.encoded_len && memcmp(data.encoded, expected, len) == 0;
+        ok = ok && base64_decode(data.encoded, len, data.decoded, &len) == 1
+                && len == data.raw_len && memcmp(data.decoded, raw, len) == 0;
+        if (!ok) {
+            printf("%-8s 输出与基线不一致\n", base64_impl_name());
+            failed = 1;
+            continue;
+        }
+
+        double enc = run(&data, 0, 1);
+        double dec = run(&data, 0, 0);
+        printf("%-8s %12.3f %12.3f\n", base64_impl_name(), enc, dec);
+    }
+
+    free(expected);
+    free(raw);
+    free(data.encoded);
+    free(data.decoded);
+    return failed;
+}
@@ -0,0 +1,131 @@
+// 并发发送基准：在本进程内启动一个模拟往返时延的SMTP服务器，同一批邮件分别用
+// 1、2、4、8个并发会话发送，输出每秒发送数、建立的连接数和加速比；
+// 再对比同一封邮件发给FANOUT_COUNT个收件人时逐个发送和多收件人事务的耗时
+// 用法: build/bench/send_bench [邮件数] [每次往返毫秒数]
+#include "mail.h"
+#include "mail_sender.h"
+#include "smtp_stub.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEFAULT_MAIL_COUNT 200
+#define DEFAULT_DELAY_MS 5
+#define BODY_SIZE 2048
+#define FANOUT_COUNT 500
+#define FANOUT_SERVER_LIMIT 40  // 第三轮服务器的单事务收件人上限
+
+int main(int argc, char* argv[]) {
+    int count = argc > 1 ? atoi(argv[1]) : DEFAULT_MAIL_COUNT;
+    if (count <= 0) count = DEFAULT_MAIL_COUNT;
+    int delay = argc > 2 ? atoi(argv[2]) : DEFAULT_DELAY_MS;
+    if (delay < 0) delay = 0;
+
+    smtp_stub_t stub;
+    if (!smtp_stub_start(&stub, delay)) {
+        fprintf(stderr, "启动本地SMTP服务器失败\n");
+        return 1;
+    }
+    mail_init();
+
+    mail_config_t config;
+    memset(&config, 0, sizeof(config));
+    config.smtp_server = "127.0.0.1";
+    config.username = "bench";
+    config.password = "bench";
+    config.port = stub.port;
+
+    // 签名内容不影响发送，所有邮件共用同一段假签名
+    char* body = malloc(BODY_SIZE + 1);
+    unsigned char signature[256];
+    if (!body) return 1;
+    for (int i = 0; i < BODY_SIZE; i++) body[i] = 'a' + i % 26;
+    body[BODY_SIZE] = '\0';
+    memset(signature, 0x5a, sizeof(signature));
+
+    mail_content_t content;
+    memset(&content, 0, sizeof(content));
+    content.from = "bench@localhost";
+    content.to = "sink@localhost";
+    content.subject = "send bench";
+    content.body = body;
+    content.signature = signature;
+    content.signature_len = sizeof(signature);
+
+    printf("%d封邮件, 每次往返%dms\n", count, delay);
+    printf("%8s %10s %10s %10s\n", "conns", "msgs/s", "connects", "speedup");
+
+    int failed = 0;
+    double base = 0;
+    for (int conns = 1; conns <= 8; conns *= 2) {
+        mail_sender_t* sender = mail_sender_new(&config, conns, NULL, NULL);
+        if (!sender) return 1;
+        smtp_stub_reset(&stub);
+        for (int i = 0; i < count; i++) {
+            mail_sender_queue(sender, &content, NULL);
+        }
+        int ok = mail_sender_run(sender);
+        double rate = count / sender->elapsed;
+        size_t connects = sender->total.connects;
+        mail_sender_free(sender);
+
+        if (!ok || atomic_load(&stub.messages) != (size_t)count) {
+            printf("%8d 发送失败: 服务器收到%zu/%d\n", conns, atomic_load(&stub.messages), count);
+            failed = 1;
+            continue;
+        }
+        if (conns == 1) base = rate;
+        printf("%8d %10.1f %10zu %9.2fx\n", conns, rate, connects, rate / base);
+    }
+
+    // 群发：逐个收件人各发一封，对比一封邮件带全部收件人(按事务拆分)
+    char* list = malloc(FANOUT_COUNT * 32);
+    if (!list) return 1;
+    size_t offset = 0;
+    for (int i = 0; i < FANOUT_COUNT; i++) {
+        offset += snprintf(list + offset, 32, "%suser%d@localhost", i ? "," : "", i);
+    }
+
+    printf("\n%d个收件人, 1个连接\n", FANOUT_COUNT);
+    printf("%-12s %8s %8s %10s %10s\n", "mode", "limit", "txns", "rcpts", "seconds");
+    for (int mode = 0; mode < 3; mode++) {
+        mail_sender_t* sender = mail_sender_new(&config, 1, NULL, NULL);
+        if (!sender) return 1;
+        smtp_stub_reset(&stub);
+        stub.max_recipients = mode == 2 ? FANOUT_SERVER_LIMIT : 0;
+
+        mail_content_t fanout = content;
+        if (mode == 0) {
+            char to[32];
+            for (int i = 0; i < FANOUT_COUNT; i++) {
+                snprintf(to, sizeof(to), "user%d@localhost", i);
+                fanout.to = to;
+                mail_sender_queue(sender, &fanout, NULL);
+            }
+        } else {
+            fanout.bcc = list;
+            mail_sender_queue(sender, &fanout, NULL);
+        }
+        int ok = mail_sender_run(sender);
+        size_t transactions = sender->total.transactions;
+        size_t limit = sender->rcpt_limit;
+        double elapsed = sender->elapsed;
+        mail_sender_free(sender);
+
+        // 逐个发送时To中的一个地址加上Bcc中的FANOUT_COUNT个
+        size_t expected = mode == 0 ? FANOUT_COUNT : FANOUT_COUNT + 1;
+        const char* name = mode == 0 ? "per-rcpt" : mode == 1 ? "fan-out" : "fan-out/452";
+        if (!ok || atomic_load(&stub.recipients) != expected) {
+            printf("%-12s 发送失败: 服务器收到%zu/%zu个收件人\n", name, atomic_load(&stub.recipients), expected);
+            failed = 1;
+            continue;
+        }
+        printf("%-12s %8zu %8zu %10zu %10.3f\n", name, limit, transactions, expected, elapsed);
+    }
+    stub.max_recipients = 0;
+
+    free(list);
+    free(body);
+    mail_cleanup();
+    return failed;
+}
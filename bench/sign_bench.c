@@ -0,0 +1,136 @@
+// 签名算法性能基准：RSA-2048、Ed25519、ECDSA P-256的每秒签名/验签次数和签名长度，
+// 以及RSA批量签名随线程数的扩展性
+// 用法: build/bench/sign_bench [消息字节数]
+#include "crypto.h"
+#include "thread_pool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DEFAULT_MESSAGE_SIZE 1024
+#define MIN_SECONDS 1.0
+#define BATCH_COUNT 2000
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// RSA批量签名：BATCH_COUNT条不同的消息，线程数从1翻倍到CPU数(至少到8)
+static int bench_batch(size_t size) {
+    EVP_PKEY* pkey = generate_key(SIG_KEY_RSA);
+    char* bodies = malloc(BATCH_COUNT * size);
+    sign_input_t* inputs = malloc(BATCH_COUNT * sizeof(sign_input_t));
+    sign_output_t* outputs = calloc(BATCH_COUNT, sizeof(sign_output_t));
+    if (!pkey || !bodies || !inputs || !outputs) return 1;
+
+    for (size_t i = 0; i < BATCH_COUNT; i++) {
+        char* body = bodies + i * size;
+        for (size_t j = 0; j < size; j++) body[j] = 'a' + (i + j) % 26;
+        inputs[i].data = body;
+        inputs[i].len = size;
+    }
+
+    int cpus = thread_pool_default_threads();
+    printf("\nRSA批量签名: %d条, 在线CPU %d\n", BATCH_COUNT, cpus);
+    printf("%8s %12s %10s\n", "threads", "sign/s", "speedup");
+
+    int failed = 0;
+    double base = 0;
+    for (int threads = 1; threads <= (cpus > 8 ? cpus : 8); threads *= 2) {
+        double start = now_seconds();
+        size_t ok = sign_batch(pkey, inputs, BATCH_COUNT, threads, 0, outputs);
+        double rate = BATCH_COUNT / (now_seconds() - start);
+
+        // 抽查结果顺序：每条签名必须对应同一下标的输入
+        for (size_t i = 0; i < BATCH_COUNT && ok == BATCH_COUNT; i += BATCH_COUNT / 16) {
+            if (!verify_signature_key(pkey, inputs[i].data, inputs[i].len,
+                                      outputs[i].signature, outputs[i].len, 0)) {
+                ok = 0;
+            }
+        }
+        sign_batch_free(outputs, BATCH_COUNT);
+
+        if (ok != BATCH_COUNT) {
+            printf("%8d 批量签名结果错误\n", threads);
+            failed = 1;
+            continue;
+        }
+        if (threads == 1) base = rate;
+        printf("%8d %12.0f %9.2fx\n", threads, rate, rate / base);
+    }
+
+    free(outputs);
+    free(inputs);
+    free(bodies);
+    EVP_PKEY_free(pkey);
+    return failed;
+}
+
+int main(int argc, char* argv[]) {
+    size_t size = argc > 1 ? (size_t)atol(argv[1]) : DEFAULT_MESSAGE_SIZE;
+    if (size == 0) size = DEFAULT_MESSAGE_SIZE;
+
+    unsigned char* message = malloc(size);
+    if (!message) return 1;
+    for (size_t i = 0; i < size; i++) message[i] = 'a' + i % 26;
+
+    const struct {
+        sig_key_type_t type;
+        const char* name;
+    } algs[] = {
+        { SIG_KEY_RSA, "rsa-2048" },
+        { SIG_KEY_ED25519, "ed25519" },
+        { SIG_KEY_ECDSA_P256, "ecdsa-p256" },
+    };
+
+    printf("消息长度: %zu字节\n", size);
+    printf("%-12s %12s %12s %10s\n", "alg", "sign/s", "verify/s", "sig bytes");
+
+    int failed = 0;
+    for (size_t k = 0; k < sizeof(algs) / sizeof(algs[0]); k++) {
+        EVP_PKEY* pkey = generate_key(algs[k].type);
+        if (!pkey) {
+            printf("%-12s 密钥生成失败\n", algs[k].name);
+            failed = 1;
+            continue;
+        }
+
+        unsigned int sig_len = 0;
+        unsigned char* signature = NULL;
+        int rounds = 0;
+        double start = now_seconds(), elapsed = 0;
+        do {
+            free(signature);
+            signature = sign_message_key(pkey, message, size, 0, &sig_len);
+            rounds++;
+            elapsed = now_seconds() - start;
+        } while (signature && elapsed < MIN_SECONDS);
+        double sign_ops = rounds / elapsed;
+
+        int ok = 1;
+        rounds = 0;
+        start = now_seconds();
+        do {
+            ok = signature && verify_signature_key(pkey, message, size, signature, sig_len, 0);
+            rounds++;
+            elapsed = now_seconds() - start;
+        } while (ok && elapsed < MIN_SECONDS);
+        double verify_ops = rounds / elapsed;
+
+        if (!ok) {
+            printf("%-12s 签名或验签失败\n", algs[k].name);
+            failed = 1;
+        } else {
+            printf("%-12s %12.0f %12.0f %10u\n", algs[k].name, sign_ops, verify_ops, sig_len);
+        }
+
+        free(signature);
+        EVP_PKEY_free(pkey);
+    }
+
+    free(message);
+    return bench_batch(size) || failed;
+}
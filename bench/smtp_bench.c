@@ -0,0 +1,161 @@
+// SMTP引擎基准：在本进程内启动一个模拟往返时延的SMTP服务器，同一批邮件分别用libcurl
+// 和内置引擎(逐条、PIPELINING+DATA、PIPELINING+BDAT)经一个连接发送，输出每秒发送数、
+// 每封邮件的往返次数和相对libcurl的加速比；再对比一封邮件发给RCPT_COUNT个收件人的耗时，
+// 最后检查服务器限制单个事务收件人数时每个收件人都正好收到一份
+// 用法: build/bench/smtp_bench [邮件数] [每次往返毫秒数]
+#include "mail.h"
+#include "mail_sender.h"
+#include "smtp_stub.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEFAULT_MAIL_COUNT 200
+#define DEFAULT_DELAY_MS 5
+#define BODY_SIZE 2048
+#define RCPT_COUNT 100
+#define LIMITED_RCPT_COUNT 8  // 服务器每个事务只接受LIMITED_RCPT_MAX个，其余回复452
+#define LIMITED_RCPT_MAX 3
+
+typedef struct {
+    const char* name;
+    int native;
+    int extensions;  // 允许内置引擎使用的扩展
+} engine_t;
+
+static const engine_t engines[] = {
+    { "curl", 0, 0 },
+    { "lockstep", 1, SMTP_EXT_AUTH_PLAIN | SMTP_EXT_AUTH_LOGIN },
+    { "pipelining", 1, ~SMTP_EXT_CHUNKING },
+    { "bdat", 1, ~0 },
+};
+#define ENGINE_COUNT (int)(sizeof(engines) / sizeof(engines[0]))
+
+// 用指定引擎发送count封邮件，返回耗时，失败返回负数
+static double run_engine(const engine_t* engine, mail_config_t* config, smtp_stub_t* stub,
+                         const mail_content_t* content, int count) {
+    config->smtp_native = engine->native;
+    mail_sender_t* sender = mail_sender_new(config, 1, NULL, NULL);
+    if (!sender) return -1;
+    sender->extensions_mask = engine->extensions;
+
+    smtp_stub_reset(stub);
+    for (int i = 0; i < count; i++) mail_sender_queue(sender, content, NULL);
+    int ok = mail_sender_run(sender);
+    double elapsed = sender->elapsed;
+    mail_sender_free(sender);
+    return ok ? elapsed : -1;
+}
+
+int main(int argc, char* argv[]) {
+    int count = argc > 1 ? atoi(argv[1]) : DEFAULT_MAIL_COUNT;
+    if (count <= 0) count = DEFAULT_MAIL_COUNT;
+    int delay = argc > 2 ? atoi(argv[2]) : DEFAULT_DELAY_MS;
+    if (delay < 0) delay = 0;
+
+    smtp_stub_t stub;
+    if (!smtp_stub_start(&stub, delay)) {
+        fprintf(stderr, "启动本地SMTP服务器失败\n");
+        return 1;
+    }
+    mail_init();
+
+    mail_config_t config;
+    memset(&config, 0, sizeof(config));
+    config.smtp_server = "127.0.0.1";
+    config.username = "bench";
+    config.password = "bench";
+    config.port = stub.port;
+
+    // 正文里放几行以'.'开头的内容，DATA方式要做点填充
+    char* body = malloc(BODY_SIZE + 1);
+    unsigned char signature[256];
+    if (!body) return 1;
+    for (int i = 0; i < BODY_SIZE; i++) body[i] = i % 64 == 62 ? '\r' : i % 64 == 63 ? '\n' : i % 64 == 0 ? '.' : 'a' + i % 26;
+    body[BODY_SIZE] = '\0';
+    memset(signature, 0x5a, sizeof(signature));
+
+    mail_content_t content;
+    memset(&content, 0, sizeof(content));
+    content.from = "bench@localhost";
+    content.to = "sink@localhost";
+    content.subject = "smtp bench";
+    content.body = body;
+    content.signature = signature;
+    content.signature_len = sizeof(signature);
+
+    printf("%d封邮件, 1个连接, 每次往返%dms\n", count, delay);
+    printf("%-12s %10s %10s %10s\n", "engine", "msgs/s", "rtt/msg", "speedup");
+
+    int failed = 0;
+    double base = 0;
+    for (int e = 0; e < ENGINE_COUNT; e++) {
+        double elapsed = run_engine(&engines[e], &config, &stub, &content, count);
+        if (elapsed < 0 || atomic_load(&stub.messages) != (size_t)count) {
+            printf("%-12s 发送失败: 服务器收到%zu/%d\n", engines[e].name, atomic_load(&stub.messages), count);
+            failed = 1;
+            continue;
+        }
+        double rate = count / elapsed;
+        if (e == 0) base = rate;
+        printf("%-12s %10.1f %10.2f %9.2fx\n", engines[e].name, rate,
+               (double)atomic_load(&stub.flights) / count, rate / base);
+    }
+
+    // 一封邮件发给RCPT_COUNT个收件人
+    char* list = malloc(RCPT_COUNT * 32);
+    if (!list) return 1;
+    size_t offset = 0;
+    for (int i = 0; i < RCPT_COUNT; i++) {
+        offset += snprintf(list + offset, 32, "%suser%d@localhost", i ? "," : "", i);
+    }
+    content.to = list;
+
+    printf("\n1封邮件, %d个收件人\n", RCPT_COUNT);
+    printf("%-12s %10s %10s %10s\n", "engine", "seconds", "rtts", "speedup");
+    base = 0;
+    for (int e = 0; e < ENGINE_COUNT; e++) {
+        double elapsed = run_engine(&engines[e], &config, &stub, &content, 1);
+        if (elapsed < 0 || atomic_load(&stub.recipients) != RCPT_COUNT) {
+            printf("%-12s 发送失败: 服务器收到%zu/%d个收件人\n", engines[e].name,
+                   atomic_load(&stub.recipients), RCPT_COUNT);
+            failed = 1;
+            continue;
+        }
+        if (e == 0) base = elapsed;
+        printf("%-12s %10.3f %10zu %9.2fx\n", engines[e].name, elapsed,
+               atomic_load(&stub.flights), base / elapsed);
+    }
+
+    // 每个事务超出上限的收件人被452暂缓，要在后面的事务里各补发一次
+    content.to = list;
+    offset = 0;
+    for (int i = 0; i < LIMITED_RCPT_COUNT; i++) {
+        offset += snprintf(list + offset, 32, "%suser%d@localhost", i ? "," : "", i);
+    }
+    stub.max_recipients = LIMITED_RCPT_MAX;
+
+    printf("\n1封邮件, %d个收件人, 服务器每个事务最多接受%d个\n", LIMITED_RCPT_COUNT, LIMITED_RCPT_MAX);
+    printf("%-12s %10s %10s\n", "engine", "rcpts", "result");
+    for (int e = 0; e < ENGINE_COUNT; e++) {
+        double elapsed = run_engine(&engines[e], &config, &stub, &content, 1);
+        int exact = elapsed >= 0;
+        for (int i = 0; i < LIMITED_RCPT_COUNT; i++) {
+            char address[32];
+            snprintf(address, sizeof(address), "user%d@localhost", i);
+            size_t copies = smtp_stub_count(&stub, address);
+            if (copies != 1) {
+                printf("%-12s %s收到%zu份\n", engines[e].name, address, copies);
+                exact = 0;
+            }
+        }
+        if (!exact) failed = 1;
+        printf("%-12s %10zu %10s\n", engines[e].name, atomic_load(&stub.recipients), exact ? "ok" : "失败");
+    }
+    stub.max_recipients = 0;
+
+    free(list);
+    free(body);
+    mail_cleanup();
+    return failed;
+}
@@ -0,0 +1,306 @@
+// 基准测试用的本地SMTP服务器：每个连接一个线程，支持EHLO/AUTH/MAIL/RCPT/DATA/BDAT/RSET/QUIT，
+// 收到的邮件只计数不保存，另记下每封邮件实际投递到的收件人地址。回复先攒在缓冲区里，读完客户端一批(一个flight)的命令后
+// 等待delay_ms再一起发出，用来模拟网络往返时延
+#ifndef SMTP_STUB_H
+#define SMTP_STUB_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#define SMTP_STUB_BUF 65536
+
+typedef struct {
+    int listen_fd;
+    int port;
+    int delay_ms;
+    int max_messages;     // 单连接邮件数上限，超过后回复421并断开，0为不限
+    int max_recipients;   // 单封邮件收件人上限，超过的RCPT回复452，0为不限
+    int extensions;       // 是否通告PIPELINING和CHUNKING
+    const char* busy_rcpt;  // RCPT地址包含这个字符串时回复450(暂时失败)，NULL为不拒绝
+    pthread_t thread;
+    atomic_size_t messages;
+    atomic_size_t recipients;
+    atomic_size_t connections;
+    atomic_size_t flights;  // 服务器等待客户端的往返次数
+    pthread_mutex_t lock;
+    char* delivered;        // 完成投递的邮件的收件人，每行一个地址
+    size_t delivered_len, delivered_cap;
+} smtp_stub_t;
+
+typedef struct {
+    smtp_stub_t* stub;
+    int fd;
+    char in[SMTP_STUB_BUF];
+    size_t in_start, in_end;
+    char out[SMTP_STUB_BUF];
+    size_t out_len;
+    char rcpt[SMTP_STUB_BUF];  // 当前事务接受的收件人，每行一个
+    size_t rcpt_len;
+} smtp_stub_conn_t;
+
+static void smtp_stub_flush(smtp_stub_conn_t* conn) {
+    if (conn->out_len == 0) return;
+    if (conn->stub->delay_ms > 0) {
+        struct timespec ts = { conn->stub->delay_ms / 1000, (conn->stub->delay_ms % 1000) * 1000000L };
+        nanosleep(&ts, NULL);
+    }
+    size_t sent = 0;
+    while (sent < conn->out_len) {
+        ssize_t n = send(conn->fd, conn->out + sent, conn->out_len - sent, MSG_NOSIGNAL);
+        if (n <= 0) break;
+        sent += n;
+    }
+    conn->out_len = 0;
+    atomic_fetch_add(&conn->stub->flights, 1);
+}
+
+static void smtp_stub_reply(smtp_stub_conn_t* conn, const char* text) {
+    size_t len = strlen(text);
+    if (conn->out_len + len > sizeof(conn->out)) smtp_stub_flush(conn);
+    memcpy(conn->out + conn->out_len, text, len);
+    conn->out_len += len;
+}
+
+// 输入缓冲区读空时才把攒下的回复发出去，然后阻塞读下一批
+static int smtp_stub_fill(smtp_stub_conn_t* conn) {
+    if (conn->in_start > 0) {
+        memmove(conn->in, conn->in + conn->in_start, conn->in_end - conn->in_start);
+        conn->in_end -= conn->in_start;
+        conn->in_start = 0;
+    }
+    struct pollfd pfd = { conn->fd, POLLIN, 0 };
+    if (poll(&pfd, 1, 0) <= 0) smtp_stub_flush(conn);
+    ssize_t n = recv(conn->fd, conn->in + conn->in_end, sizeof(conn->in) - conn->in_end, 0);
+    if (n <= 0) return 0;
+    conn->in_end += n;
+    return 1;
+}
+
+// 读一行(不含CRLF)，连接关闭返回NULL
+static char* smtp_stub_line(smtp_stub_conn_t* conn) {
+    for (;;) {
+        char* start = conn->in + conn->in_start;
+        char* lf = memchr(start, '\n', conn->in_end - conn->in_start);
+        if (lf) {
+            conn->in_start = lf + 1 - conn->in;
+            if (lf > start && lf[-1] == '\r') lf--;
+            *lf = '\0';
+            return start;
+        }
+        if (conn->in_end - conn->in_start == sizeof(conn->in)) conn->in_start = conn->in_end;
+        if (!smtp_stub_fill(conn)) return NULL;
+    }
+}
+
+// 跳过n字节的BDAT数据
+static int smtp_stub_skip(smtp_stub_conn_t* conn, size_t n) {
+    while (n > 0) {
+        size_t avail = conn->in_end - conn->in_start;
+        if (avail == 0) {
+            if (!smtp_stub_fill(conn)) return 0;
+            continue;
+        }
+        size_t take = avail < n ? avail : n;
+        conn->in_start += take;
+        n -= take;
+    }
+    return 1;
+}
+
+// 记下RCPT TO:<地址>中的地址，放不下的不记
+static void smtp_stub_add_rcpt(smtp_stub_conn_t* conn, const char* line) {
+    const char* open = strchr(line, '<');
+    const char* close = open ? strchr(open, '>') : NULL;
+    if (!close) return;
+    size_t len = close - open - 1;
+    if (conn->rcpt_len + len + 1 > sizeof(conn->rcpt)) return;
+    memcpy(conn->rcpt + conn->rcpt_len, open + 1, len);
+    conn->rcpt[conn->rcpt_len + len] = '\n';
+    conn->rcpt_len += len + 1;
+}
+
+// 一封邮件投递完成，把它的收件人加入记录
+static void smtp_stub_deliver(smtp_stub_conn_t* conn, int recipients) {
+    smtp_stub_t* stub = conn->stub;
+    atomic_fetch_add(&stub->messages, 1);
+    atomic_fetch_add(&stub->recipients, recipients);
+
+    pthread_mutex_lock(&stub->lock);
+    if (stub->delivered_len + conn->rcpt_len > stub->delivered_cap) {
+        size_t cap = (stub->delivered_len + conn->rcpt_len) * 2;
+        char* delivered = realloc(stub->delivered, cap);
+        if (delivered) {
+            stub->delivered = delivered;
+            stub->delivered_cap = cap;
+        }
+    }
+    if (stub->delivered_len + conn->rcpt_len <= stub->delivered_cap) {
+        memcpy(stub->delivered + stub->delivered_len, conn->rcpt, conn->rcpt_len);
+        stub->delivered_len += conn->rcpt_len;
+    }
+    pthread_mutex_unlock(&stub->lock);
+}
+
+// address收到的邮件份数
+static inline size_t smtp_stub_count(smtp_stub_t* stub, const char* address) {
+    size_t count = 0, len = strlen(address);
+    pthread_mutex_lock(&stub->lock);
+    const char* p = stub->delivered;
+    const char* end = p + stub->delivered_len;
+    while (p < end) {
+        const char* lf = memchr(p, '\n', end - p);
+        if ((size_t)(lf - p) == len && memcmp(p, address, len) == 0) count++;
+        p = lf + 1;
+    }
+    pthread_mutex_unlock(&stub->lock);
+    return count;
+}
+
+static void* smtp_stub_session(void* arg) {
+    smtp_stub_conn_t* conn = (smtp_stub_conn_t*)arg;
+    smtp_stub_t* stub = conn->stub;
+    int messages = 0, recipients = 0;
+    char* line;
+
+    atomic_fetch_add(&stub->connections, 1);
+    smtp_stub_reply(conn, "220 localhost ESMTP stub\r\n");
+    smtp_stub_flush(conn);
+
+    while ((line = smtp_stub_line(conn))) {
+        if (!strncasecmp(line, "EHLO", 4) || !strncasecmp(line, "HELO", 4)) {
+            smtp_stub_reply(conn, stub->extensions
+                ? "250-localhost\r\n250-PIPELINING\r\n250-CHUNKING\r\n250-8BITMIME\r\n250 AUTH PLAIN LOGIN\r\n"
+                : "250-localhost\r\n250-8BITMIME\r\n250 AUTH PLAIN LOGIN\r\n");
+        } else if (!strncasecmp(line, "AUTH LOGIN", 10)) {
+            smtp_stub_reply(conn, "334 VXNlcm5hbWU6\r\n");
+            if (!smtp_stub_line(conn)) break;
+            smtp_stub_reply(conn, "334 UGFzc3dvcmQ6\r\n");
+            if (!smtp_stub_line(conn)) break;
+            smtp_stub_reply(conn, "235 ok\r\n");
+        } else if (!strncasecmp(line, "AUTH PLAIN", 10)) {
+            if (!line[10] && (smtp_stub_reply(conn, "334 \r\n"), !smtp_stub_line(conn))) break;
+            smtp_stub_reply(conn, "235 ok\r\n");
+        } else if (!strncasecmp(line, "MAIL", 4)) {
+            if (stub->max_messages && messages >= stub->max_messages) {
+                smtp_stub_reply(conn, "421 too many messages\r\n");
+                break;
+            }
+            recipients = 0;
+            conn->rcpt_len = 0;
+            smtp_stub_reply(conn, "250 ok\r\n");
+        } else if (!strncasecmp(line, "RCPT", 4)) {
+            if (stub->max_recipients && recipients >= stub->max_recipients) {
+                smtp_stub_reply(conn, "452 too many recipients\r\n");
+            } else if (stub->busy_rcpt && strstr(line, stub->busy_rcpt)) {
+                smtp_stub_reply(conn, "450 mailbox busy\r\n");
+            } else {
+                recipients++;
+                smtp_stub_add_rcpt(conn, line);
+                smtp_stub_reply(conn, "250 ok\r\n");
+            }
+        } else if (!strncasecmp(line, "DATA", 4)) {
+            smtp_stub_reply(conn, "354 go ahead\r\n");
+            while ((line = smtp_stub_line(conn)) && strcmp(line, ".") != 0) {}
+            if (!line) break;
+            messages++;
+            smtp_stub_deliver(conn, recipients);
+            smtp_stub_reply(conn, "250 queued\r\n");
+        } else if (!strncasecmp(line, "BDAT", 4)) {
+            char* last = NULL;
+            size_t n = strtoul(line + 5, &last, 10);
+            if (!smtp_stub_skip(conn, n)) break;
+            if (last && !strncasecmp(last + strspn(last, " "), "LAST", 4)) {
+                messages++;
+                smtp_stub_deliver(conn, recipients);
+            }
+            smtp_stub_reply(conn, "250 ok\r\n");
+        } else if (!strncasecmp(line, "RSET", 4) || !strncasecmp(line, "NOOP", 4)) {
+            if (!strncasecmp(line, "RSET", 4)) conn->rcpt_len = 0;
+            smtp_stub_reply(conn, "250 ok\r\n");
+        } else if (!strncasecmp(line, "QUIT", 4)) {
+            smtp_stub_reply(conn, "221 bye\r\n");
+            break;
+        } else {
+            smtp_stub_reply(conn, "500 unknown command\r\n");
+        }
+    }
+
+    smtp_stub_flush(conn);
+    close(conn->fd);
+    free(conn);
+    return NULL;
+}
+
+static void* smtp_stub_accept(void* arg) {
+    smtp_stub_t* stub = (smtp_stub_t*)arg;
+    for (;;) {
+        int fd = accept(stub->listen_fd, NULL, NULL);
+        if (fd < 0) break;
+
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        smtp_stub_conn_t* conn = calloc(1, sizeof(smtp_stub_conn_t));
+        pthread_t thread;
+        if (!conn) {
+            close(fd);
+            continue;
+        }
+        conn->stub = stub;
+        conn->fd = fd;
+        if (pthread_create(&thread, NULL, smtp_stub_session, conn) != 0) {
+            close(fd);
+            free(conn);
+            continue;
+        }
+        pthread_detach(thread);
+    }
+    return NULL;
+}
+
+// 在127.0.0.1的随机端口上启动，失败返回0
+static int smtp_stub_start(smtp_stub_t* stub, int delay_ms) {
+    memset(stub, 0, sizeof(*stub));
+    stub->delay_ms = delay_ms;
+    stub->extensions = 1;
+    pthread_mutex_init(&stub->lock, NULL);
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+
+    stub->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (stub->listen_fd < 0
+        || bind(stub->listen_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0
+        || listen(stub->listen_fd, 128) < 0
+        || getsockname(stub->listen_fd, (struct sockaddr*)&addr, &len) < 0) {
+        return 0;
+    }
+    stub->port = ntohs(addr.sin_port);
+    return pthread_create(&stub->thread, NULL, smtp_stub_accept, stub) == 0;
+}
+
+// 清零计数，用于下一轮测量
+static void smtp_stub_reset(smtp_stub_t* stub) {
+    atomic_store(&stub->messages, 0);
+    atomic_store(&stub->recipients, 0);
+    atomic_store(&stub->connections, 0);
+    atomic_store(&stub->flights, 0);
+    pthread_mutex_lock(&stub->lock);
+    stub->delivered_len = 0;
+    pthread_mutex_unlock(&stub->lock);
+}
+
+#endif // SMTP_STUB_H
@@ -0,0 +1,129 @@
+// 发件队列基准：生产者入队的单封耗时，与同一封邮件直接走SMTP往返发送的耗时对比，
+// 再用投递进程的一轮投递把队列清空；最后检查部分收件人暂时失败时只有它们被重新投递
+// 用法: build/bench/spool_bench [邮件数] [每次往返毫秒数]
+#include "mail.h"
+#include "mail_spool.h"
+#include "smtp_stub.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DEFAULT_MAIL_COUNT 2000
+#define DEFAULT_DELAY_MS 5
+#define DIRECT_COUNT 20
+#define BODY_SIZE 2048
+#define BENCH_SPOOL_FILE "/tmp/crymail_spool_bench.spool"
+#define BENCH_INDEX_FILE "/tmp/crymail_spool_bench.idx"
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char* argv[]) {
+    int count = argc > 1 ? atoi(argv[1]) : DEFAULT_MAIL_COUNT;
+    if (count <= 0) count = DEFAULT_MAIL_COUNT;
+    int delay = argc > 2 ? atoi(argv[2]) : DEFAULT_DELAY_MS;
+    if (delay < 0) delay = 0;
+
+    smtp_stub_t stub;
+    if (!smtp_stub_start(&stub, delay)) {
+        fprintf(stderr, "启动本地SMTP服务器失败\n");
+        return 1;
+    }
+    mail_init();
+
+    mail_config_t config;
+    memset(&config, 0, sizeof(config));
+    config.smtp_server = "127.0.0.1";
+    config.username = "bench";
+    config.password = "bench";
+    config.port = stub.port;
+
+    // 签名内容不影响投递；所有邮件内容相同，每次入队的Message-ID不同，都应各投递一次
+    char* body = malloc(BODY_SIZE + 1);
+    unsigned char signature[256];
+    if (!body) return 1;
+    for (int i = 0; i < BODY_SIZE; i++) body[i] = 'a' + i % 26;
+    body[BODY_SIZE] = '\0';
+    memset(signature, 0x5a, sizeof(signature));
+
+    mail_content_t content;
+    memset(&content, 0, sizeof(content));
+    content.from = "bench@localhost";
+    content.to = "sink@localhost";
+    content.subject = "spool bench";
+    content.body = body;
+    content.signature = signature;
+    content.signature_len = sizeof(signature);
+
+    printf("每次往返%dms\n", delay);
+    printf("%-10s %8s %12s\n", "path", "mails", "us/mail");
+
+    // 直接发送：每封一个SMTP会话
+    double start = now_seconds();
+    int failed = 0;
+    for (int i = 0; i < DIRECT_COUNT; i++) {
+        if (!send_signed_mail(&config, &content)) failed = 1;
+    }
+    printf("%-10s %8d %12.1f\n", "send", DIRECT_COUNT, (now_seconds() - start) / DIRECT_COUNT * 1e6);
+
+    unlink(BENCH_SPOOL_FILE);
+    unlink(BENCH_INDEX_FILE);
+    mail_spool_t* spool = mail_spool_open(BENCH_SPOOL_FILE, BENCH_INDEX_FILE);
+    if (!spool) return 1;
+
+    start = now_seconds();
+    for (int i = 0; i < count; i++) {
+        if (!mail_spool_enqueue(spool, &content)) failed = 1;
+    }
+    printf("%-10s %8d %12.1f\n", "enqueue", count, (now_seconds() - start) / count * 1e6);
+
+    // 投递进程：每轮最多一批，直到队列清空
+    mail_spool_stats_t stats;
+    size_t sent = 0;
+    smtp_stub_reset(&stub);
+    start = now_seconds();
+    do {
+        if (!mail_spool_deliver(spool, &config, 4, &stats)) {
+            failed = 1;
+            break;
+        }
+        sent += stats.sent;
+    } while (stats.pending && stats.sent);
+    printf("%-10s %8zu %12.1f  (4连接, 服务器收到%zu封)\n", "deliver", sent,
+           (now_seconds() - start) / (sent ? sent : 1) * 1e6, atomic_load(&stub.messages));
+    if (sent != (size_t)count || stats.pending) failed = 1;
+
+    // 一个收件人暂时失败：其余收件人各收到一份，重试只发给它。显示名中的逗号不是分隔符
+    const char* const expected[] = { "a@localhost", "b@localhost", "busy@localhost" };
+    content.to = "\"Sink, A\" <a@localhost>, b@localhost, busy@localhost";
+    for (int native = 0; native < 2; native++) {
+        config.smtp_native = native;
+        smtp_stub_reset(&stub);
+        stub.busy_rcpt = "busy@";
+        if (!mail_spool_enqueue(spool, &content) || !mail_spool_deliver(spool, &config, 1, &stats)) failed = 1;
+        int partial = stats.sent == 1 && stats.deferred == 1;
+
+        // 新记录在下一轮读入，按退避推迟；改成立即到期再投递
+        stub.busy_rcpt = NULL;
+        if (!mail_spool_deliver(spool, &config, 1, &stats)) failed = 1;
+        for (size_t i = 0; i < spool->record_count; i++) spool->records[i].next_attempt = 0;
+        if (!mail_spool_deliver(spool, &config, 1, &stats) || stats.pending) failed = 1;
+
+        int exact = partial && atomic_load(&stub.recipients) == 3;
+        for (int i = 0; i < 3; i++) exact = exact && smtp_stub_count(&stub, expected[i]) == 1;
+        printf("%-10s 部分收件人重试: %s\n", native ? "native" : "curl", exact ? "ok" : "失败");
+        if (!exact) failed = 1;
+    }
+
+    mail_spool_close(spool);
+    unlink(BENCH_SPOOL_FILE);
+    unlink(BENCH_INDEX_FILE);
+    free(body);
+    mail_cleanup();
+    return failed;
+}
@@ -0,0 +1,117 @@
+// 批量验签扩展性基准：同一批签名邮件分别用1、2、4...个线程验证，输出每秒验签数和加速比，
+// 再对比首次验签写缓存和重复验签命中缓存的速度
+// 用法: build/bench/verify_bench [邮件数] [rsa|ed25519|p256]
+#include "mail.h"
+#include "mail_verify.h"
+#include "crypto.h"
+#include "base64.h"
+#include "thread_pool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DEFAULT_MAIL_COUNT 2000
+#define BODY_SIZE 2048
+#define BENCH_CACHE_FILE "/tmp/crymail_verify_bench.cache"
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char* argv[]) {
+    int count = argc > 1 ? atoi(argv[1]) : DEFAULT_MAIL_COUNT;
+    if (count <= 0) count = DEFAULT_MAIL_COUNT;
+
+    sig_key_type_t type = SIG_KEY_RSA;
+    if (argc > 2 && strcmp(argv[2], "ed25519") == 0) type = SIG_KEY_ED25519;
+    else if (argc > 2 && strcmp(argv[2], "p256") == 0) type = SIG_KEY_ECDSA_P256;
+
+    EVP_PKEY* pkey = generate_key(type);
+    if (!pkey) {
+        fprintf(stderr, "密钥生成失败\n");
+        return 1;
+    }
+
+    // 构造一批已签名的完整邮件
+    mail_list_t list;
+    memset(&list, 0, sizeof(list));
+    list.arena = arena_new(1024 * 1024);
+    list.items = calloc(count, sizeof(mail_item_t));
+    list.count = count;
+
+    for (int i = 0; i < count; i++) {
+        mail_item_t* item = &list.items[i];
+        item->body = arena_alloc(list.arena, BODY_SIZE + 1);
+        for (int j = 0; j < BODY_SIZE; j++) item->body[j] = 'a' + (i + j) % 26;
+        item->body[BODY_SIZE] = '\0';
+
+        unsigned int sig_len = 0;
+        unsigned char* signature = sign_message_key(pkey, item->body, BODY_SIZE, 0, &sig_len);
+        if (!signature) {
+            fprintf(stderr, "签名失败\n");
+            return 1;
+        }
+
+        size_t encoded_len = 0;
+        item->signature_file = arena_alloc(list.arena, (sig_len + 2) / 3 * 4 + 1);
+        base64_encode(signature, sig_len, item->signature_file, &encoded_len);
+        item->signature_file_len = encoded_len;
+        item->signature_alg = arena_strdup(list.arena, sig_alg_name(pkey));
+        char message_id[64];
+        snprintf(message_id, sizeof(message_id), "<bench-%d@crymail>", i);
+        item->message_id = arena_strdup(list.arena, message_id);
+        item->has_signature = 1;
+        item->complete = 1;
+        free(signature);
+    }
+
+    int cpus = thread_pool_default_threads();
+    printf("%d封邮件, 算法%s, 在线CPU %d\n", count, sig_alg_name(pkey), cpus);
+    printf("%8s %12s %10s\n", "threads", "verify/s", "speedup");
+
+    double base = 0;
+    int failed = 0;
+    for (int threads = 1; threads <= (cpus > 8 ? cpus : 8); threads *= 2) {
+        mail_verify_stats_t stats;
+        double start = now_seconds();
+        verify_mail_list_key(&list, pkey, NULL, threads, &stats);
+        double rate = count / (now_seconds() - start);
+
+        if (stats.verified != (size_t)count) {
+            printf("%8d 验签结果错误: 通过%zu/%d\n", threads, stats.verified, count);
+            failed = 1;
+            continue;
+        }
+        if (threads == 1) base = rate;
+        printf("%8d %12.0f %9.2fx\n", threads, rate, rate / base);
+    }
+
+    // 单线程：第一遍全部未命中并写入缓存，第二遍重新打开缓存文件后全部命中
+    unlink(BENCH_CACHE_FILE);
+    printf("\n%8s %12s %10s\n", "cache", "verify/s", "hits");
+    for (int round = 0; round < 2; round++) {
+        mail_verify_stats_t stats;
+        double start = now_seconds();
+        verify_cache_t* cache = verify_cache_open(BENCH_CACHE_FILE);
+        verify_mail_list_key(&list, pkey, cache, 1, &stats);
+        verify_cache_close(cache);
+        double rate = count / (now_seconds() - start);
+
+        if (!cache || stats.verified != (size_t)count) {
+            printf("%8s 验签结果错误: 通过%zu/%d\n", round ? "warm" : "cold", stats.verified, count);
+            failed = 1;
+            continue;
+        }
+        printf("%8s %12.0f %10zu\n", round ? "warm" : "cold", rate, stats.cached);
+    }
+    unlink(BENCH_CACHE_FILE);
+
+    free(list.items);
+    arena_free(list.arena);
+    EVP_PKEY_free(pkey);
+    return failed;
+}
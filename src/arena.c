@@ -0,0 +1,89 @@
+#include "arena.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define ARENA_ALIGN sizeof(void*)
+
+struct arena_block {
+    arena_block_t* next;
+    size_t size;
+    size_t used;
+    char data[];
+};
+
+static arena_block_t* new_block(size_t size, arena_block_t* next) {
+    arena_block_t* block = malloc(sizeof(arena_block_t) + size);
+    if (!block) return NULL;
+
+    block->next = next;
+    block->size = size;
+    block->used = 0;
+    return block;
+}
+
+arena_t* arena_new(size_t block_size) {
+    arena_t* arena = malloc(sizeof(arena_t));
+    if (!arena) return NULL;
+
+    arena->block_size = block_size;
+    arena->head = NULL;
+    return arena;
+}
+
+void* arena_alloc(arena_t* arena, size_t len) {
+    len = (len + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+
+    arena_block_t* block = arena->head;
+    if (!block || block->size - block->used < len) {
+        if (len > arena->block_size / 4) {
+            // 大对象单独成块，挂在当前块后面，不浪费当前块剩余空间
+            arena_block_t* big = new_block(len, block ? block->next : NULL);
+            if (!big) return NULL;
+            big->used = len;
+            if (block) block->next = big;
+            else arena->head = big;
+            return big->data;
+        }
+
+        block = new_block(arena->block_size, block);
+        if (!block) return NULL;
+        arena->head = block;
+    }
+
+    void* ptr = block->data + block->used;
+    block->used += len;
+    return ptr;
+}
+
+char* arena_strndup(arena_t* arena, const char* str, size_t len) {
+    char* copy = arena_alloc(arena, len + 1);
+    if (!copy) return NULL;
+
+    memcpy(copy, str, len);
+    copy[len] = '\0';
+    return copy;
+}
+
+char* arena_strdup(arena_t* arena, const char* str) {
+    return arena_strndup(arena, str, strlen(str));
+}
+
+size_t arena_size(const arena_t* arena) {
+    size_t total = 0;
+    for (arena_block_t* block = arena->head; block; block = block->next) {
+        total += block->size;
+    }
+    return total;
+}
+
+void arena_free(arena_t* arena) {
+    if (!arena) return;
+
+    arena_block_t* block = arena->head;
+    while (block) {
+        arena_block_t* next = block->next;
+        free(block);
+        block = next;
+    }
+    free(arena);
+}
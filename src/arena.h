@@ -0,0 +1,32 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+// 内存池：从大块内存中顺序分配，不单独释放，arena_free一次性回收全部
+typedef struct arena_block arena_block_t;
+
+typedef struct {
+    arena_block_t* head;  // 当前分配所在的块
+    size_t block_size;
+} arena_t;
+
+// 创建内存池，block_size为每次向系统申请的块大小
+arena_t* arena_new(size_t block_size);
+
+// 分配len字节(按指针大小对齐)，失败返回NULL
+void* arena_alloc(arena_t* arena, size_t len);
+
+// 复制len字节并以'\0'结尾
+char* arena_strndup(arena_t* arena, const char* str, size_t len);
+
+// 复制字符串
+char* arena_strdup(arena_t* arena, const char* str);
+
+// 已申请的总字节数
+size_t arena_size(const arena_t* arena);
+
+// 释放内存池及其中分配的全部内存
+void arena_free(arena_t* arena);
+
+#endif // ARENA_H
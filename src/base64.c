@@ -1,74 +1,500 @@
 #include "base64.h"
 #include <string.h>
 
-static const char base64_chars[] = 
+// x86上用GCC/Clang的target属性单独编译SIMD内核，运行时按CPU特性选择，
+// 不需要给整个项目加-mavx2，在不支持的CPU上自动退回标量实现
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define BASE64_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+static const char base64_chars[] =
     "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
 
-int base64_encode(const unsigned char* input, size_t input_len, 
-                 char* output, size_t* output_len) {
-    size_t i, j;
+// 字符到6位值的查找表，非法字符为-1
+static const signed char base64_index[256] = {
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 62, -1, -1, -1, 63,
+    52, 53, 54, 55, 56, 57, 58, 59, 60, 61, -1, -1, -1, -1, -1, -1,
+    -1,  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14,
+    15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, -1, -1, -1, -1, -1,
+    -1, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
+    41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+};
 
-    // 计算输出长度
-    *output_len = 4 * ((input_len + 2) / 3);
+// 批量内核：编码返回已处理的输入字节数(3的倍数)，
+// 解码返回已处理的输入字符数(4的倍数)，遇到非法字符的块留给标量代码报错
+typedef size_t (*encode_kernel_t)(const unsigned char* input, size_t input_len, char* output);
+typedef size_t (*decode_kernel_t)(const char* input, size_t input_len, unsigned char* output);
 
-    for (i = 0, j = 0; i < input_len;) {
-        unsigned int octet_a = i < input_len ? input[i++] : 0;
-        unsigned int octet_b = i < input_len ? input[i++] : 0;
-        unsigned int octet_c = i < input_len ? input[i++] : 0;
+static size_t encode_scalar(const unsigned char* input, size_t input_len, char* output) {
+    size_t i = 0;
 
-        unsigned int triple = (octet_a << 16) + (octet_b << 8) + octet_c;
+    for (; i + 3 <= input_len; i += 3) {
+        unsigned int triple = (input[i] << 16) | (input[i + 1] << 8) | input[i + 2];
 
-        output[j++] = base64_chars[(triple >> 18) & 0x3F];
-        output[j++] = base64_chars[(triple >> 12) & 0x3F];
-        output[j++] = base64_chars[(triple >> 6) & 0x3F];
-        output[j++] = base64_chars[triple & 0x3F];
+        *output++ = base64_chars[(triple >> 18) & 0x3F];
+        *output++ = base64_chars[(triple >> 12) & 0x3F];
+        *output++ = base64_chars[(triple >> 6) & 0x3F];
+        *output++ = base64_chars[triple & 0x3F];
     }
+    return i;
+}
 
-    // 添加填充
-    if (input_len % 3 == 1) {
-        output[*output_len - 1] = '=';
-        output[*output_len - 2] = '=';
+static size_t decode_scalar(const char* input, size_t input_len, unsigned char* output) {
+    const unsigned char* in = (const unsigned char*)input;
+    size_t i = 0;
+
+    for (; i + 4 <= input_len; i += 4) {
+        int a = base64_index[in[i]];
+        int b = base64_index[in[i + 1]];
+        int c = base64_index[in[i + 2]];
+        int d = base64_index[in[i + 3]];
+        if ((a | b | c | d) < 0) break;
+
+        unsigned int triple = (a << 18) | (b << 12) | (c << 6) | d;
+        *output++ = (triple >> 16) & 0xFF;
+        *output++ = (triple >> 8) & 0xFF;
+        *output++ = triple & 0xFF;
+    }
+    return i;
+}
+
+#ifdef BASE64_X86_SIMD
+
+// 编码：把每3字节拆成4个6位索引，再用pshufb查表把索引平移成ASCII
+__attribute__((target("sse4.1")))
+static inline __m128i encode_block_sse(__m128i in) {
+    in = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+
+    __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+    __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+    __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+    __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+    __m128i indices = _mm_or_si128(t1, t3);
+
+    __m128i result = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+    __m128i less = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+    result = _mm_or_si128(result, _mm_and_si128(less, _mm_set1_epi8(13)));
+
+    const __m128i shift_lut = _mm_setr_epi8(
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+    return _mm_add_epi8(_mm_shuffle_epi8(shift_lut, result), indices);
+}
+
+__attribute__((target("sse4.1")))
+static size_t encode_sse41(const unsigned char* input, size_t input_len, char* output) {
+    size_t i = 0;
+
+    // 每次读16字节只用前12字节，保证不越过输入末尾
+    for (; i + 16 <= input_len; i += 12) {
+        __m128i in = _mm_loadu_si128((const __m128i*)(input + i));
+        _mm_storeu_si128((__m128i*)output, encode_block_sse(in));
+        output += 16;
     }
-    else if (input_len % 3 == 2) {
-        output[*output_len - 1] = '=';
+    return i;
+}
+
+__attribute__((target("avx2")))
+static size_t encode_avx2(const unsigned char* input, size_t input_len, char* output) {
+    size_t i = 0;
+
+    // 两个128位通道各处理12字节
+    for (; i + 28 <= input_len; i += 24) {
+        __m256i in = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)(input + i))),
+            _mm_loadu_si128((const __m128i*)(input + i + 12)), 1);
+
+        in = _mm256_shuffle_epi8(in, _mm256_set_epi8(
+            10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1,
+            10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+
+        __m256i t0 = _mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00));
+        __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+        __m256i t2 = _mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0));
+        __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+        __m256i indices = _mm256_or_si256(t1, t3);
+
+        __m256i result = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+        __m256i less = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+        result = _mm256_or_si256(result, _mm256_and_si256(less, _mm256_set1_epi8(13)));
+
+        const __m256i shift_lut = _mm256_setr_epi8(
+            'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+            '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+            'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+            '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+        result = _mm256_add_epi8(_mm256_shuffle_epi8(shift_lut, result), indices);
+
+        _mm256_storeu_si256((__m256i*)output, result);
+        output += 32;
     }
+    return i;
+}
 
-    output[*output_len] = '\0';
+// 解码：按高低半字节查表同时完成合法性检查和ASCII到6位值的平移，
+// 再用乘加指令把4个6位值拼成3字节
+__attribute__((target("sse4.1")))
+static inline int decode_block_sse(__m128i in, __m128i* out) {
+    const __m128i lut_lo = _mm_setr_epi8(
+        0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+        0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m128i lut_hi = _mm_setr_epi8(
+        0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+        0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m128i lut_roll = _mm_setr_epi8(
+        0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i mask_2f = _mm_set1_epi8(0x2f);
+
+    __m128i hi_nibbles = _mm_and_si128(_mm_srli_epi32(in, 4), _mm_set1_epi8(0x0f));
+    __m128i lo_nibbles = _mm_and_si128(in, _mm_set1_epi8(0x0f));
+    __m128i lo = _mm_shuffle_epi8(lut_lo, lo_nibbles);
+    __m128i hi = _mm_shuffle_epi8(lut_hi, hi_nibbles);
+    if (!_mm_testz_si128(lo, hi)) return 0;
+
+    __m128i eq_2f = _mm_cmpeq_epi8(in, mask_2f);
+    __m128i roll = _mm_shuffle_epi8(lut_roll, _mm_add_epi8(eq_2f, hi_nibbles));
+    __m128i values = _mm_add_epi8(in, roll);
+
+    __m128i merged = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+    merged = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+    *out = _mm_shuffle_epi8(merged, _mm_setr_epi8(
+        2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
     return 1;
 }
 
-static int char_to_index(char c) {
-    if (c >= 'A' && c <= 'Z') return c - 'A';
-    if (c >= 'a' && c <= 'z') return c - 'a' + 26;
-    if (c >= '0' && c <= '9') return c - '0' + 52;
-    if (c == '+') return 62;
-    if (c == '/') return 63;
-    return -1;
+__attribute__((target("sse4.1")))
+static size_t decode_sse41(const char* input, size_t input_len, unsigned char* output) {
+    size_t i = 0;
+
+    // 每块写出16字节其中12字节有效，至少再留8个字符保证不写过输出末尾，
+    // 末尾可能带'='的4个字符也因此总是交给标量代码
+    for (; i + 24 <= input_len; i += 16) {
+        __m128i out;
+        if (!decode_block_sse(_mm_loadu_si128((const __m128i*)(input + i)), &out)) break;
+        _mm_storeu_si128((__m128i*)output, out);
+        output += 12;
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+static size_t decode_avx2(const char* input, size_t input_len, unsigned char* output) {
+    const __m256i lut_lo = _mm256_setr_epi8(
+        0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+        0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+        0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+        0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m256i lut_hi = _mm256_setr_epi8(
+        0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+        0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+        0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+        0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m256i lut_roll = _mm256_setr_epi8(
+        0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i pack_shuffle = _mm256_setr_epi8(
+        2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+        2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    size_t i = 0;
+
+    // 每块写出32字节其中24字节有效，至少再留16个字符
+    for (; i + 48 <= input_len; i += 32) {
+        __m256i in = _mm256_loadu_si256((const __m256i*)(input + i));
+
+        __m256i hi_nibbles = _mm256_and_si256(_mm256_srli_epi32(in, 4), _mm256_set1_epi8(0x0f));
+        __m256i lo_nibbles = _mm256_and_si256(in, _mm256_set1_epi8(0x0f));
+        __m256i lo = _mm256_shuffle_epi8(lut_lo, lo_nibbles);
+        __m256i hi = _mm256_shuffle_epi8(lut_hi, hi_nibbles);
+        if (!_mm256_testz_si256(lo, hi)) break;
+
+        __m256i eq_2f = _mm256_cmpeq_epi8(in, _mm256_set1_epi8(0x2f));
+        __m256i roll = _mm256_shuffle_epi8(lut_roll, _mm256_add_epi8(eq_2f, hi_nibbles));
+        __m256i values = _mm256_add_epi8(in, roll);
+
+        __m256i merged = _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+        merged = _mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000));
+        merged = _mm256_shuffle_epi8(merged, pack_shuffle);
+        merged = _mm256_permutevar8x32_epi32(merged, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+
+        _mm256_storeu_si256((__m256i*)output, merged);
+        output += 24;
+    }
+    return i;
+}
+
+#endif // BASE64_X86_SIMD
+
+typedef struct {
+    encode_kernel_t encode;
+    decode_kernel_t decode;
+    base64_impl_t impl;
+} base64_kernels_t;
+
+static const base64_kernels_t scalar_kernels = { encode_scalar, decode_scalar, BASE64_IMPL_SCALAR };
+#ifdef BASE64_X86_SIMD
+static const base64_kernels_t sse41_kernels = { encode_sse41, decode_sse41, BASE64_IMPL_SSE41 };
+static const base64_kernels_t avx2_kernels = { encode_avx2, decode_avx2, BASE64_IMPL_AVX2 };
+#endif
+
+// 当前使用的内核，第一次调用时按CPU特性选择；多线程同时初始化的结果相同
+static const base64_kernels_t* active_kernels = NULL;
+
+static const base64_kernels_t* kernels_for(base64_impl_t impl) {
+#ifdef BASE64_X86_SIMD
+    __builtin_cpu_init();
+    int has_avx2 = __builtin_cpu_supports("avx2");
+    int has_sse41 = __builtin_cpu_supports("sse4.1");
+
+    switch (impl) {
+    case BASE64_IMPL_AUTO:
+        if (has_avx2) return &avx2_kernels;
+        if (has_sse41) return &sse41_kernels;
+        return &scalar_kernels;
+    case BASE64_IMPL_AVX2:
+        return has_avx2 ? &avx2_kernels : NULL;
+    case BASE64_IMPL_SSE41:
+        return has_sse41 ? &sse41_kernels : NULL;
+    default:
+        return &scalar_kernels;
+    }
+#else
+    return (impl == BASE64_IMPL_AUTO || impl == BASE64_IMPL_SCALAR) ? &scalar_kernels : NULL;
+#endif
+}
+
+static const base64_kernels_t* get_kernels(void) {
+    const base64_kernels_t* kernels = __atomic_load_n(&active_kernels, __ATOMIC_ACQUIRE);
+    if (!kernels) {
+        kernels = kernels_for(BASE64_IMPL_AUTO);
+        __atomic_store_n(&active_kernels, kernels, __ATOMIC_RELEASE);
+    }
+    return kernels;
+}
+
+int base64_set_impl(base64_impl_t impl) {
+    const base64_kernels_t* kernels = kernels_for(impl);
+    if (!kernels) return 0;
+
+    __atomic_store_n(&active_kernels, kernels, __ATOMIC_RELEASE);
+    return 1;
+}
+
+const char* base64_impl_name(void) {
+    switch (get_kernels()->impl) {
+    case BASE64_IMPL_AVX2: return "avx2";
+    case BASE64_IMPL_SSE41: return "sse4.1";
+    default: return "scalar";
+    }
+}
+
+// 编码末尾不足3字节的输入并补'='，n为1或2，返回写出的字符数
+static size_t encode_tail(const unsigned char* input, size_t n, char* output) {
+    unsigned int triple = input[0] << 16;
+    if (n == 2) triple |= input[1] << 8;
+
+    output[0] = base64_chars[(triple >> 18) & 0x3F];
+    output[1] = base64_chars[(triple >> 12) & 0x3F];
+    output[2] = n == 2 ? base64_chars[(triple >> 6) & 0x3F] : '=';
+    output[3] = '=';
+    return 4;
+}
+
+int base64_encode(const unsigned char* input, size_t input_len,
+                 char* output, size_t* output_len) {
+    // 计算输出长度
+    *output_len = 4 * ((input_len + 2) / 3);
+
+    // 先用SIMD内核处理大块，剩余的整组和末尾不足3字节的部分用标量代码
+    size_t i = get_kernels()->encode(input, input_len, output);
+    i += encode_scalar(input + i, input_len - i, output + i / 3 * 4);
+
+    // 添加填充
+    if (i < input_len) {
+        encode_tail(input + i, input_len - i, output + i / 3 * 4);
+    }
+
+    output[*output_len] = '\0';
+    return 1;
 }
 
 int base64_decode(const char* input, size_t input_len,
                  unsigned char* output, size_t* output_len) {
-    size_t i, j;
-
     if (input_len % 4 != 0) return 0;
 
-    *output_len = input_len / 4 * 3;
-    if (input[input_len - 1] == '=') (*output_len)--;
-    if (input[input_len - 2] == '=') (*output_len)--;
+    *output_len = 0;
+    if (input_len == 0) return 1;
 
-    for (i = 0, j = 0; i < input_len;) {
-        unsigned int sextet_a = input[i] == '=' ? 0 : char_to_index(input[i]); i++;
-        unsigned int sextet_b = input[i] == '=' ? 0 : char_to_index(input[i]); i++;
-        unsigned int sextet_c = input[i] == '=' ? 0 : char_to_index(input[i]); i++;
-        unsigned int sextet_d = input[i] == '=' ? 0 : char_to_index(input[i]); i++;
+    // 最后一组可能带填充，单独处理
+    size_t body_len = input_len - 4;
+    size_t i = get_kernels()->decode(input, body_len, output);
+    i += decode_scalar(input + i, body_len - i, output + i / 4 * 3);
+    if (i != body_len) return 0;  // 含非法字符
 
-        unsigned int triple = (sextet_a << 18) + (sextet_b << 12) +
-                            (sextet_c << 6) + sextet_d;
+    size_t j = i / 4 * 3;
+    const unsigned char* last = (const unsigned char*)input + i;
+    int a = base64_index[last[0]];
+    int b = base64_index[last[1]];
+    int c = last[2] == '=' && last[3] == '=' ? 0 : base64_index[last[2]];
+    int d = last[3] == '=' ? 0 : base64_index[last[3]];
+    if ((a | b | c | d) < 0) return 0;
 
-        if (j < *output_len) output[j++] = (triple >> 16) & 0xFF;
-        if (j < *output_len) output[j++] = (triple >> 8) & 0xFF;
-        if (j < *output_len) output[j++] = triple & 0xFF;
-    }
+    unsigned int triple = (a << 18) | (b << 12) | (c << 6) | d;
+    output[j++] = (triple >> 16) & 0xFF;
+    if (last[2] != '=') output[j++] = (triple >> 8) & 0xFF;
+    if (last[3] != '=') output[j++] = triple & 0xFF;
 
+    *output_len = j;
     return 1;
-} 
\ No newline at end of file
+}
+
+size_t base64_encoded_max(size_t len, size_t line_max) {
+    size_t chars = (len + 2) / 3 * 4 + 4;  // 多算一组，覆盖上一块剩下的字节
+    size_t width = line_max / 4 * 4;
+    return width ? chars + (chars / width + 1) * 2 : chars;
+}
+
+void base64_encoder_init(base64_encoder_t* enc, size_t line_max) {
+    memset(enc, 0, sizeof(*enc));
+    enc->line_max = line_max / 4 * 4;  // 保证量子不会跨行
+}
+
+// 行满时先补CRLF，保证接下来的4个字符能放在同一行
+static char* encoder_wrap(base64_encoder_t* enc, char* output) {
+    if (enc->line_max && enc->column == enc->line_max) {
+        *output++ = '\r';
+        *output++ = '\n';
+        enc->column = 0;
+    }
+    return output;
+}
+
+// 编码n字节(3的倍数)并按行宽换行，每行内部仍然走SIMD内核
+static char* encoder_emit(base64_encoder_t* enc, const unsigned char* input, size_t n, char* output) {
+    const base64_kernels_t* kernels = get_kernels();
+
+    while (n > 0) {
+        output = encoder_wrap(enc, output);
+
+        size_t take = enc->line_max ? (enc->line_max - enc->column) / 4 * 3 : n;
+        if (take > n) take = n;
+
+        size_t done = kernels->encode(input, take, output);
+        encode_scalar(input + done, take - done, output + done / 3 * 4);
+
+        output += take / 3 * 4;
+        enc->column += take / 3 * 4;
+        input += take;
+        n -= take;
+    }
+    return output;
+}
+
+size_t base64_encode_update(base64_encoder_t* enc, const unsigned char* input, size_t len, char* output) {
+    char* out = output;
+
+    // 先把上一块剩下的字节凑满一组
+    if (enc->carry_len > 0) {
+        while (enc->carry_len < 3 && len > 0) {
+            enc->carry[enc->carry_len++] = *input++;
+            len--;
+        }
+        if (enc->carry_len < 3) return 0;
+
+        out = encoder_emit(enc, enc->carry, 3, out);
+        enc->carry_len = 0;
+    }
+
+    size_t whole = len / 3 * 3;
+    out = encoder_emit(enc, input, whole, out);
+
+    enc->carry_len = len - whole;
+    memcpy(enc->carry, input + whole, enc->carry_len);
+    return out - output;
+}
+
+size_t base64_encode_final(base64_encoder_t* enc, char* output) {
+    if (enc->carry_len == 0) return 0;
+
+    char* out = encoder_wrap(enc, output);
+    out += encode_tail(enc->carry, enc->carry_len, out);
+    enc->column += 4;
+    enc->carry_len = 0;
+    return out - output;
+}
+
+size_t base64_decoded_max(size_t len) {
+    // 上一块最多留下3个字符，SIMD内核按块写出时也不会超过这个范围
+    return (len + 3) / 4 * 3 + 3;
+}
+
+void base64_decoder_init(base64_decoder_t* dec) {
+    memset(dec, 0, sizeof(*dec));
+}
+
+// 逐字符处理一个字符，量子凑满时写出，返回写出的字节数，出错时设置error
+static size_t decoder_push(base64_decoder_t* dec, unsigned char c, unsigned char* output) {
+    if (c == ' ' || c == '\t' || c == '\r' || c == '\n') return 0;
+
+    if (c == '=') {
+        // 填充只能出现在量子的第3、4位
+        if (dec->quad_len < 2) {
+            dec->error = 1;
+            return 0;
+        }
+        dec->pad++;
+        dec->quad[dec->quad_len++] = 0;
+    } else {
+        int value = base64_index[c];
+        if (value < 0 || dec->pad) {
+            dec->error = 1;
+            return 0;
+        }
+        dec->quad[dec->quad_len++] = value;
+    }
+
+    if (dec->quad_len < 4) return 0;
+
+    unsigned int triple = (dec->quad[0] << 18) | (dec->quad[1] << 12) | (dec->quad[2] << 6) | dec->quad[3];
+    output[0] = (triple >> 16) & 0xFF;
+    output[1] = (triple >> 8) & 0xFF;
+    output[2] = triple & 0xFF;
+    dec->quad_len = 0;
+    return 3 - dec->pad;
+}
+
+int base64_decode_update(base64_decoder_t* dec, const char* input, size_t len,
+                         unsigned char* output, size_t* output_len) {
+    const base64_kernels_t* kernels = get_kernels();
+    const unsigned char* in = (const unsigned char*)input;
+    size_t i = 0, j = 0;
+
+    while (i < len && !dec->error) {
+        // 量子对齐时整段连续的base64字符走批量内核，遇到换行或填充再逐字符处理
+        if (dec->quad_len == 0 && !dec->pad) {
+            size_t n = kernels->decode(input + i, len - i, output + j);
+            n += decode_scalar(input + i + n, len - i - n, output + j + n / 4 * 3);
+            i += n;
+            j += n / 4 * 3;
+            if (i >= len) break;
+        }
+        j += decoder_push(dec, in[i++], output + j);
+    }
+
+    *output_len = j;
+    return !dec->error;
+}
+
+int base64_decode_final(base64_decoder_t* dec) {
+    return !dec->error && dec->quad_len == 0;
+}
@@ -11,4 +11,60 @@ extern int base64_encode(const unsigned char* input, size_t input_len,
 extern int base64_decode(const char* input, size_t input_len,
                  unsigned char* output, size_t* output_len);
 
+// RFC 2045规定的每行最大字符数
+#define BASE64_LINE_MAX 76
+
+// 流式编码器：输入可以任意切块，每line_max个字符插入一个CRLF
+typedef struct {
+    unsigned char carry[3];  // 上一块剩下不足3字节的输入
+    size_t carry_len;
+    size_t line_max;         // 0表示不换行
+    size_t column;           // 当前行已输出的字符数
+} base64_encoder_t;
+
+// 流式解码器：跳过空白和CRLF，量子(4个字符)可以跨块
+typedef struct {
+    unsigned char quad[4];   // 当前量子中已读到的6位值
+    int quad_len;
+    int pad;                 // 已读到的'='个数，之后只允许空白
+    int error;
+} base64_decoder_t;
+
+// 编码len字节输入(含换行和final)所需的最大输出长度，不含结尾'\0'
+size_t base64_encoded_max(size_t len, size_t line_max);
+
+void base64_encoder_init(base64_encoder_t* enc, size_t line_max);
+
+// 编码一块输入，output至少要有base64_encoded_max(len, line_max)字节，返回写出的字符数
+size_t base64_encode_update(base64_encoder_t* enc, const unsigned char* input, size_t len, char* output);
+
+// 输出剩余的不足3字节并补'='，output至少要有6字节，返回写出的字符数(不追加结尾换行)
+size_t base64_encode_final(base64_encoder_t* enc, char* output);
+
+// 解码len个字符所需的最大输出长度
+size_t base64_decoded_max(size_t len);
+
+void base64_decoder_init(base64_decoder_t* dec);
+
+// 解码一块输入，output至少要有base64_decoded_max(len)字节；遇到非法字符返回0
+int base64_decode_update(base64_decoder_t* dec, const char* input, size_t len,
+                         unsigned char* output, size_t* output_len);
+
+// 结束解码，输入在量子中间截断时返回0
+int base64_decode_final(base64_decoder_t* dec);
+
+// 编解码实现，默认按CPU特性自动选择
+typedef enum {
+    BASE64_IMPL_AUTO,
+    BASE64_IMPL_SCALAR,
+    BASE64_IMPL_SSE41,
+    BASE64_IMPL_AVX2
+} base64_impl_t;
+
+// 强制使用指定实现(用于基准测试和对比)，CPU不支持时返回0
+int base64_set_impl(base64_impl_t impl);
+
+// 当前使用的实现名称
+const char* base64_impl_name(void);
+
 #endif // BASE64_H 
\ No newline at end of file
@@ -1,31 +1,56 @@
 #include "crypto.h"
+#include "keyring.h"
+#include "thread_pool.h"
 #include <stdio.h>
 #include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
 #include <openssl/evp.h>
 #include <openssl/pem.h>
 #include <openssl/err.h>
+#include <openssl/ec.h>
+#include <strings.h>
 
 #define RSA_KEY_BITS 2048
 #define DIGEST_ALG EVP_sha256()
+#define SIG_READ_CHUNK (64 * 1024)  // 从文件描述符读取的块大小
 
-int generate_key_pair(const char* public_key_file, const char* private_key_file) {
+EVP_PKEY* generate_key(sig_key_type_t type) {
     EVP_PKEY_CTX *ctx = NULL;
     EVP_PKEY *pkey = NULL;
-    BIO *bp_public = NULL, *bp_private = NULL;
-    int ret = 0;
 
-    // 创建RSA密钥生成上下文
-    ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_RSA, NULL);
+    // 创建对应算法的密钥生成上下文
+    if (type == SIG_KEY_ED25519) ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_ED25519, NULL);
+    else if (type == SIG_KEY_ECDSA_P256) ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, NULL);
+    else ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_RSA, NULL);
     if (!ctx) goto cleanup;
 
     // 初始化密钥生成
     if (EVP_PKEY_keygen_init(ctx) <= 0) goto cleanup;
 
-    // 设置RSA密钥长度
-    if (EVP_PKEY_CTX_set_rsa_keygen_bits(ctx, RSA_KEY_BITS) <= 0) goto cleanup;
+    // 设置RSA密钥长度或EC曲线
+    if (type == SIG_KEY_RSA && EVP_PKEY_CTX_set_rsa_keygen_bits(ctx, RSA_KEY_BITS) <= 0) goto cleanup;
+    if (type == SIG_KEY_ECDSA_P256 && EVP_PKEY_CTX_set_ec_paramgen_curve_nid(ctx, NID_X9_62_prime256v1) <= 0) goto cleanup;
 
     // 生成密钥对
-    if (EVP_PKEY_keygen(ctx, &pkey) <= 0) goto cleanup;
+    if (EVP_PKEY_keygen(ctx, &pkey) <= 0) pkey = NULL;
+
+cleanup:
+    EVP_PKEY_CTX_free(ctx);
+    return pkey;
+}
+
+int generate_key_pair(const char* public_key_file, const char* private_key_file) {
+    return generate_key_pair_ex(public_key_file, private_key_file, SIG_KEY_RSA);
+}
+
+int generate_key_pair_ex(const char* public_key_file, const char* private_key_file, sig_key_type_t type) {
+    BIO *bp_public = NULL, *bp_private = NULL;
+    int ret = 0;
+
+    EVP_PKEY* pkey = generate_key(type);
+    if (!pkey) goto cleanup;
 
     // 保存公钥
     bp_public = BIO_new_file(public_key_file, "w+");
@@ -38,7 +63,6 @@ int generate_key_pair(const char* public_key_file, const char* private_key_file)
     ret = 1;
 
 cleanup:
-    EVP_PKEY_CTX_free(ctx);
     EVP_PKEY_free(pkey);
     BIO_free_all(bp_public);
     BIO_free_all(bp_private);
@@ -46,46 +70,191 @@ cleanup:
     return ret;
 }
 
+const char* sig_alg_name(const EVP_PKEY* pkey) {
+    switch (EVP_PKEY_get_base_id(pkey)) {
+    case EVP_PKEY_RSA:
+        return SIG_ALG_RSA_SHA256;
+    case EVP_PKEY_ED25519:
+        return SIG_ALG_ED25519;
+    case EVP_PKEY_EC: {
+        char group[32];
+        if (EVP_PKEY_get_group_name(pkey, group, sizeof(group), NULL)
+            && (strcmp(group, "prime256v1") == 0 || strcmp(group, "P-256") == 0)) {
+            return SIG_ALG_ECDSA_P256;
+        }
+        return NULL;
+    }
+    default:
+        return NULL;
+    }
+}
+
+const char* sig_alg_name_file(const char* key_file, int is_private) {
+    EVP_PKEY* pkey = keyring_get(keyring_default(), key_file, is_private ? KEY_PRIVATE : KEY_PUBLIC);
+    if (!pkey) return NULL;
+
+    const char* name = sig_alg_name(pkey);
+    EVP_PKEY_free(pkey);
+    return name;
+}
+
+int sig_alg_matches(const EVP_PKEY* pkey, const char* alg, size_t alg_len) {
+    const char* name = sig_alg_name(pkey);
+    return name && strlen(name) == alg_len && strncasecmp(name, alg, alg_len) == 0;
+}
+
+// Ed25519在签名内部完成摘要，不能指定摘要算法
+static const EVP_MD* digest_for(const EVP_PKEY* pkey) {
+    return EVP_PKEY_get_base_id(pkey) == EVP_PKEY_ED25519 ? NULL : DIGEST_ALG;
+}
+
 unsigned char* calculate_digest(const char* message, unsigned int* digest_len) {
+    return calculate_digest_buf(message, strlen(message), digest_len);
+}
+
+unsigned char* calculate_digest_buf(const void* data, size_t len, unsigned int* digest_len) {
     EVP_MD_CTX *mdctx = EVP_MD_CTX_new();
     unsigned char *digest = malloc(EVP_MAX_MD_SIZE);
     
     EVP_DigestInit_ex(mdctx, DIGEST_ALG, NULL);
-    EVP_DigestUpdate(mdctx, message, strlen(message));
+    EVP_DigestUpdate(mdctx, data, len);
     EVP_DigestFinal_ex(mdctx, digest, digest_len);
     
     EVP_MD_CTX_free(mdctx);
     return digest;
 }
 
-unsigned char* sign_message(const char* message, const char* private_key_file, 
-                          unsigned int* signature_len) {
-    FILE* fp = fopen(private_key_file, "r");
-    if (!fp) return NULL;
+int calculate_digest_file(const char* path, unsigned char* digest, unsigned int* digest_len) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
 
-    EVP_PKEY* pkey = PEM_read_PrivateKey(fp, NULL, NULL, NULL);
-    fclose(fp);
-    if (!pkey) return NULL;
+    EVP_MD_CTX* mdctx = EVP_MD_CTX_new();
+    unsigned char buf[SIG_READ_CHUNK];
+    ssize_t n;
+    int ok = mdctx && EVP_DigestInit_ex(mdctx, DIGEST_ALG, NULL);
 
-    // 计算消息摘要
-    unsigned int digest_len;
-    unsigned char* digest = calculate_digest(message, &digest_len);
+    while (ok && (n = read(fd, buf, sizeof(buf))) != 0) {
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            ok = 0;
+        } else {
+            ok = EVP_DigestUpdate(mdctx, buf, n);
+        }
+    }
+    ok = ok && EVP_DigestFinal_ex(mdctx, digest, digest_len);
 
-    // 创建签名上下文
-    EVP_MD_CTX* ctx = EVP_MD_CTX_new();
+    EVP_MD_CTX_free(mdctx);
+    close(fd);
+    return ok;
+}
+
+// 初始化签名/验签上下文的公共部分
+static int sig_ctx_init(sig_ctx_t* ctx, EVP_PKEY* pkey, int flags, int verify) {
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->verify = verify;
+    ctx->md = EVP_MD_CTX_new();
+    if (!ctx->md) goto fail;
+
+    const EVP_MD* md = digest_for(pkey);
+    int ok = verify ? EVP_DigestVerifyInit(ctx->md, NULL, md, NULL, pkey)
+                    : EVP_DigestSignInit(ctx->md, NULL, md, NULL, pkey);
+    if (ok <= 0) goto fail;
+
+    // Ed25519要对整条消息做两遍SHA-512，OpenSSL只支持一次性签名，内容先缓存到final
+    ctx->oneshot = (md == NULL);
+
+    if (flags & SIG_LEGACY_DOUBLE_HASH) {
+        ctx->legacy = EVP_MD_CTX_new();
+        if (!ctx->legacy || EVP_DigestInit_ex(ctx->legacy, DIGEST_ALG, NULL) <= 0) goto fail;
+    }
+    return 1;
+
+fail:
+    sig_ctx_free(ctx);
+    return 0;
+}
+
+int sign_init(sig_ctx_t* ctx, EVP_PKEY* pkey, int flags) {
+    return sig_ctx_init(ctx, pkey, flags, 0);
+}
+
+int verify_init(sig_ctx_t* ctx, EVP_PKEY* pkey, int flags) {
+    return sig_ctx_init(ctx, pkey, flags, 1);
+}
+
+// 一次性签名算法的内容缓存
+static int oneshot_append(sig_ctx_t* ctx, const void* data, size_t len) {
+    if (ctx->len + len > ctx->cap) {
+        size_t cap = ctx->cap ? ctx->cap * 2 : 4096;
+        while (cap < ctx->len + len) cap *= 2;
+
+        unsigned char* buf = realloc(ctx->buf, cap);
+        if (!buf) return 0;
+        ctx->buf = buf;
+        ctx->cap = cap;
+    }
+    memcpy(ctx->buf + ctx->len, data, len);
+    ctx->len += len;
+    return 1;
+}
+
+int sig_update(sig_ctx_t* ctx, const void* data, size_t len) {
+    if (!ctx->md) return 0;
+    if (len == 0) return 1;
+
+    // 兼容模式先单独求摘要，final时再把摘要交给签名上下文
+    if (ctx->legacy) return EVP_DigestUpdate(ctx->legacy, data, len) > 0;
+    if (ctx->oneshot) return oneshot_append(ctx, data, len);
+    if (ctx->verify) return EVP_DigestVerifyUpdate(ctx->md, data, len) > 0;
+    return EVP_DigestSignUpdate(ctx->md, data, len) > 0;
+}
+
+int sig_update_fd(sig_ctx_t* ctx, int fd) {
+    unsigned char buf[SIG_READ_CHUNK];
+    ssize_t n;
+
+    while ((n = read(fd, buf, sizeof(buf))) != 0) {
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return 0;
+        }
+        if (!sig_update(ctx, buf, n)) return 0;
+    }
+    return 1;
+}
+
+// 兼容模式下把内容摘要作为真正要签名的数据
+static int finish_legacy(sig_ctx_t* ctx) {
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int digest_len = 0;
+
+    if (EVP_DigestFinal_ex(ctx->legacy, digest, &digest_len) <= 0) return 0;
+    EVP_MD_CTX_free(ctx->legacy);
+    ctx->legacy = NULL;
+    return sig_update(ctx, digest, digest_len);
+}
+
+unsigned char* sign_final(sig_ctx_t* ctx, unsigned int* signature_len) {
     unsigned char* signature = NULL;
-    size_t sig_len;
+    size_t sig_len = 0;
+    int ok;
+
+    if (!ctx->md || ctx->verify) goto cleanup;
+    if (ctx->legacy && !finish_legacy(ctx)) goto cleanup;
 
-    if (EVP_DigestSignInit(ctx, NULL, DIGEST_ALG, NULL, pkey) <= 0) goto cleanup;
-    
     // 计算签名长度
-    if (EVP_DigestSign(ctx, NULL, &sig_len, digest, digest_len) <= 0) goto cleanup;
-    
+    if (ctx->oneshot) ok = EVP_DigestSign(ctx->md, NULL, &sig_len, ctx->buf, ctx->len);
+    else ok = EVP_DigestSignFinal(ctx->md, NULL, &sig_len);
+    if (ok <= 0) goto cleanup;
+
     // 分配签名缓冲区
     signature = malloc(sig_len);
-    
-    // 生成签名
-    if (EVP_DigestSign(ctx, signature, &sig_len, digest, digest_len) <= 0) {
+    if (!signature) goto cleanup;
+
+    // 生成签名(ECDSA的实际长度可能小于上面给出的最大长度)
+    if (ctx->oneshot) ok = EVP_DigestSign(ctx->md, signature, &sig_len, ctx->buf, ctx->len);
+    else ok = EVP_DigestSignFinal(ctx->md, signature, &sig_len);
+    if (ok <= 0) {
         free(signature);
         signature = NULL;
         goto cleanup;
@@ -94,39 +263,180 @@ unsigned char* sign_message(const char* message, const char* private_key_file,
     *signature_len = sig_len;
 
 cleanup:
-    EVP_MD_CTX_free(ctx);
+    sig_ctx_free(ctx);
+    return signature;
+}
+
+int verify_final(sig_ctx_t* ctx, const unsigned char* signature, unsigned int signature_len) {
+    int ret = 0;
+
+    if (ctx->md && ctx->verify && (!ctx->legacy || finish_legacy(ctx))) {
+        if (ctx->oneshot) {
+            ret = (EVP_DigestVerify(ctx->md, signature, signature_len, ctx->buf, ctx->len) == 1);
+        } else {
+            ret = (EVP_DigestVerifyFinal(ctx->md, signature, signature_len) == 1);
+        }
+    }
+
+    sig_ctx_free(ctx);
+    return ret;
+}
+
+void sig_ctx_free(sig_ctx_t* ctx) {
+    EVP_MD_CTX_free(ctx->md);
+    EVP_MD_CTX_free(ctx->legacy);
+    free(ctx->buf);
+    ctx->md = NULL;
+    ctx->legacy = NULL;
+    ctx->buf = NULL;
+    ctx->len = ctx->cap = 0;
+}
+
+unsigned char* sign_message(const char* message, const char* private_key_file, 
+                          unsigned int* signature_len) {
+    EVP_PKEY* pkey = keyring_get(keyring_default(), private_key_file, KEY_PRIVATE);
+    if (!pkey) return NULL;
+
+    unsigned char* signature = sign_message_key(pkey, message, strlen(message), 0, signature_len);
     EVP_PKEY_free(pkey);
-    free(digest);
-    
     return signature;
 }
 
+unsigned char* sign_message_key(EVP_PKEY* pkey, const void* message, size_t message_len,
+                                int flags, unsigned int* signature_len) {
+    sig_ctx_t ctx;
+    if (!sign_init(&ctx, pkey, flags)) return NULL;
+
+    if (!sig_update(&ctx, message, message_len)) {
+        sig_ctx_free(&ctx);
+        return NULL;
+    }
+    return sign_final(&ctx, signature_len);
+}
+
 int verify_signature(const char* message, unsigned char* signature,
                     unsigned int signature_len, const char* public_key_file) {
-    FILE* fp = fopen(public_key_file, "r");
-    if (!fp) return 0;
-
-    EVP_PKEY* pkey = PEM_read_PUBKEY(fp, NULL, NULL, NULL);
-    fclose(fp);
+    EVP_PKEY* pkey = keyring_get(keyring_default(), public_key_file, KEY_PUBLIC);
     if (!pkey) return 0;
 
-    // 计算消息摘要
-    unsigned int digest_len;
-    unsigned char* digest = calculate_digest(message, &digest_len);
-
-    // 创建验证上下文
-    EVP_MD_CTX* ctx = EVP_MD_CTX_new();
-    int ret = 0;
+    // 单独的签名文件没有格式标记，新格式不通过时再按旧的双重摘要格式验证
+    size_t message_len = strlen(message);
+    int ret = verify_signature_key(pkey, message, message_len, signature, signature_len, 0)
+           || verify_signature_key(pkey, message, message_len, signature, signature_len,
+                                   SIG_LEGACY_DOUBLE_HASH);
+    EVP_PKEY_free(pkey);
+    return ret;
+}
 
-    if (EVP_DigestVerifyInit(ctx, NULL, DIGEST_ALG, NULL, pkey) <= 0) goto cleanup;
-    
-    // 验证签名
-    ret = (EVP_DigestVerify(ctx, signature, signature_len, digest, digest_len) == 1);
+int verify_signature_buf(const void* message, size_t message_len, unsigned char* signature,
+                         unsigned int signature_len, const char* public_key_file, int flags) {
+    EVP_PKEY* pkey = keyring_get(keyring_default(), public_key_file, KEY_PUBLIC);
+    if (!pkey) return 0;
 
-cleanup:
-    EVP_MD_CTX_free(ctx);
+    int ret = verify_signature_key(pkey, message, message_len, signature, signature_len, flags);
     EVP_PKEY_free(pkey);
-    free(digest);
-    
     return ret;
+}
+
+int verify_signature_key(EVP_PKEY* pkey, const void* message, size_t message_len,
+                         const unsigned char* signature, unsigned int signature_len, int flags) {
+    sig_ctx_t ctx;
+    if (!verify_init(&ctx, pkey, flags)) return 0;
+
+    if (!sig_update(&ctx, message, message_len)) {
+        sig_ctx_free(&ctx);
+        return 0;
+    }
+    return verify_final(&ctx, signature, signature_len);
+}
+
+int verify_signature_md(EVP_MD_CTX* md, EVP_PKEY* pkey, const void* message, size_t message_len,
+                        const unsigned char* signature, unsigned int signature_len, int flags) {
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int digest_len = 0;
+
+    // 旧格式签的是内容摘要
+    if (flags & SIG_LEGACY_DOUBLE_HASH) {
+        if (!EVP_Digest(message, message_len, digest, &digest_len, DIGEST_ALG, NULL)) return 0;
+        message = digest;
+        message_len = digest_len;
+    }
+
+    if (!EVP_MD_CTX_reset(md)) return 0;
+    if (EVP_DigestVerifyInit(md, NULL, digest_for(pkey), NULL, pkey) <= 0) return 0;
+    return EVP_DigestVerify(md, signature, signature_len, message, message_len) == 1;
+}
+
+unsigned char* sign_message_md(EVP_MD_CTX* md, EVP_PKEY* pkey, const void* message, size_t message_len,
+                               int flags, unsigned int* signature_len) {
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int digest_len = 0;
+
+    // 旧格式签的是内容摘要
+    if (flags & SIG_LEGACY_DOUBLE_HASH) {
+        if (!EVP_Digest(message, message_len, digest, &digest_len, DIGEST_ALG, NULL)) return NULL;
+        message = digest;
+        message_len = digest_len;
+    }
+
+    size_t sig_len = 0;
+    if (!EVP_MD_CTX_reset(md)) return NULL;
+    if (EVP_DigestSignInit(md, NULL, digest_for(pkey), NULL, pkey) <= 0) return NULL;
+    if (EVP_DigestSign(md, NULL, &sig_len, message, message_len) <= 0) return NULL;
+
+    unsigned char* signature = malloc(sig_len);
+    if (!signature) return NULL;
+
+    if (EVP_DigestSign(md, signature, &sig_len, message, message_len) <= 0) {
+        free(signature);
+        return NULL;
+    }
+    *signature_len = sig_len;
+    return signature;
+}
+
+typedef struct {
+    EVP_PKEY* pkey;
+    const sign_input_t* inputs;
+    sign_output_t* outputs;
+    int flags;
+    size_t signed_count;  // 原子累加
+} sign_batch_job_t;
+
+static void* sign_thread_init(void* arg) {
+    (void)arg;
+    return EVP_MD_CTX_new();
+}
+
+static void sign_thread_done(void* state, void* arg) {
+    (void)arg;
+    EVP_MD_CTX_free((EVP_MD_CTX*)state);
+}
+
+static void sign_one(size_t index, void* state, void* arg) {
+    sign_batch_job_t* job = (sign_batch_job_t*)arg;
+    sign_output_t* out = &job->outputs[index];
+
+    out->len = 0;
+    out->signature = state ? sign_message_md((EVP_MD_CTX*)state, job->pkey, job->inputs[index].data,
+                                             job->inputs[index].len, job->flags, &out->len)
+                           : NULL;
+    if (out->signature) __atomic_fetch_add(&job->signed_count, 1, __ATOMIC_RELAXED);
+}
+
+size_t sign_batch(EVP_PKEY* pkey, const sign_input_t* inputs, size_t count,
+                  int threads, int flags, sign_output_t* outputs) {
+    sign_batch_job_t job = { pkey, inputs, outputs, flags, 0 };
+    thread_pool_job_t pool_job = { sign_thread_init, sign_one, sign_thread_done };
+
+    // 每个线程独占一个上下文，私钥只读共享，结果按下标写回，与输入顺序一致
+    thread_pool_run(count, threads, &pool_job, &job);
+    return job.signed_count;
+}
+
+void sign_batch_free(sign_output_t* outputs, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        free(outputs[i].signature);
+        outputs[i].signature = NULL;
+    }
 } 
\ No newline at end of file
@@ -5,19 +5,128 @@
 #include <openssl/pem.h>
 #include <openssl/err.h>
 #include <openssl/sha.h>
+#include <openssl/evp.h>
+
+// 签名密钥类型，签名和验签时按密钥自动选择算法
+typedef enum {
+    SIG_KEY_RSA,         // RSA-2048 + SHA-256
+    SIG_KEY_ED25519,     // Ed25519
+    SIG_KEY_ECDSA_P256   // ECDSA P-256 + SHA-256
+} sig_key_type_t;
 
 // RSA密钥对生成
 int generate_key_pair(const char* public_key_file, const char* private_key_file);
 
-// 数字签名
+// 生成指定类型的密钥对
+int generate_key_pair_ex(const char* public_key_file, const char* private_key_file, sig_key_type_t type);
+
+// 在内存中生成指定类型的密钥，由调用者EVP_PKEY_free
+EVP_PKEY* generate_key(sig_key_type_t type);
+
+// 签名格式标志：旧版本先对内容求SHA-256，再把摘要交给EVP_DigestSign再摘要一次。
+// 新签名只摘要一次，旧签名需要带此标志验证
+#define SIG_LEGACY_DOUBLE_HASH 0x1
+
+// 邮件中标记的签名算法，没有标记的是旧格式
+#define SIG_ALG_RSA_SHA256 "rsa-sha256"
+#define SIG_ALG_ED25519    "ed25519"
+#define SIG_ALG_ECDSA_P256 "ecdsa-p256-sha256"
+
+// 密钥对应的签名算法标记，不支持的密钥返回NULL
+const char* sig_alg_name(const EVP_PKEY* pkey);
+
+// 密钥文件对应的签名算法标记
+const char* sig_alg_name_file(const char* key_file, int is_private);
+
+// 判断算法标记(长度alg_len，不区分大小写)是否与密钥一致
+int sig_alg_matches(const EVP_PKEY* pkey, const char* alg, size_t alg_len);
+
+// 流式签名/验签上下文，内容可以分块喂入，只需遍历一次。
+// Ed25519只能一次性签名，内容会先缓存在上下文中
+typedef struct {
+    EVP_MD_CTX* md;      // 签名或验签上下文，内部完成摘要
+    EVP_MD_CTX* legacy;  // 兼容旧格式时先单独求摘要
+    int verify;
+    int oneshot;         // 是否需要缓存内容
+    unsigned char* buf;
+    size_t len;
+    size_t cap;
+} sig_ctx_t;
+
+// 初始化签名/验签，flags为SIG_LEGACY_DOUBLE_HASH或0
+int sign_init(sig_ctx_t* ctx, EVP_PKEY* pkey, int flags);
+int verify_init(sig_ctx_t* ctx, EVP_PKEY* pkey, int flags);
+
+// 喂入一块内容
+int sig_update(sig_ctx_t* ctx, const void* data, size_t len);
+
+// 从文件描述符读到文件结束，全部喂入
+int sig_update_fd(sig_ctx_t* ctx, int fd);
+
+// 生成签名，返回的签名由调用者free；无论成败都会释放上下文
+unsigned char* sign_final(sig_ctx_t* ctx, unsigned int* signature_len);
+
+// 验证签名，通过返回1；无论成败都会释放上下文
+int verify_final(sig_ctx_t* ctx, const unsigned char* signature, unsigned int signature_len);
+
+// 中途放弃时释放上下文
+void sig_ctx_free(sig_ctx_t* ctx);
+
+// 数字签名(新格式)
 unsigned char* sign_message(const char* message, const char* private_key_file, 
                           unsigned int* signature_len);
 
-// 验证签名
+// 用已加载的私钥(例如从keyring_get取得的句柄)签名长度为message_len的内容
+unsigned char* sign_message_key(EVP_PKEY* pkey, const void* message, size_t message_len,
+                                int flags, unsigned int* signature_len);
+
+// 验证签名，新旧两种格式都接受
 int verify_signature(const char* message, unsigned char* signature, 
                     unsigned int signature_len, const char* public_key_file);
 
+// 按flags指定的格式验证长度为message_len的内容，内容不需要以'\0'结尾
+int verify_signature_buf(const void* message, size_t message_len, unsigned char* signature,
+                         unsigned int signature_len, const char* public_key_file, int flags);
+
+// 用已加载的公钥验证签名
+int verify_signature_key(EVP_PKEY* pkey, const void* message, size_t message_len,
+                         const unsigned char* signature, unsigned int signature_len, int flags);
+
+// 复用调用者的EVP_MD_CTX一次性签名，返回的签名由调用者free
+unsigned char* sign_message_md(EVP_MD_CTX* md, EVP_PKEY* pkey, const void* message, size_t message_len,
+                               int flags, unsigned int* signature_len);
+
+// 批量签名的一条输入
+typedef struct {
+    const void* data;
+    size_t len;
+} sign_input_t;
+
+// 批量签名的一条结果，signature为NULL表示该条签名失败
+typedef struct {
+    unsigned char* signature;
+    unsigned int len;
+} sign_output_t;
+
+// 用threads个线程(<=0时为CPU数)批量签名，每个线程一个签名上下文，共享同一个已加载的私钥。
+// outputs[i]对应inputs[i]，返回签名成功的条数
+size_t sign_batch(EVP_PKEY* pkey, const sign_input_t* inputs, size_t count,
+                  int threads, int flags, sign_output_t* outputs);
+
+// 释放批量签名结果中的签名
+void sign_batch_free(sign_output_t* outputs, size_t count);
+
+// 复用调用者的EVP_MD_CTX一次性验签，适合同一线程连续验证大量邮件
+int verify_signature_md(EVP_MD_CTX* md, EVP_PKEY* pkey, const void* message, size_t message_len,
+                        const unsigned char* signature, unsigned int signature_len, int flags);
+
 // 计算消息摘要
 unsigned char* calculate_digest(const char* message, unsigned int* digest_len);
 
+// 计算长度为len的数据的摘要
+unsigned char* calculate_digest_buf(const void* data, size_t len, unsigned int* digest_len);
+
+// 分块读取文件计算摘要，digest至少EVP_MAX_MD_SIZE字节，失败返回0
+int calculate_digest_file(const char* path, unsigned char* digest, unsigned int* digest_len);
+
 #endif // CRYPTO_H 
\ No newline at end of file
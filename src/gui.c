@@ -98,6 +98,12 @@ static void show_config_page() {
     config.port = atoi(gui_config.port);
     config.pop3_port = atoi(gui_config.pop3_port);
     config.use_ssl = gui_config.use_ssl;
+
+    // 界面上不设置发送引擎，沿用配置文件中原有的smtp_engine
+    mail_config_t existing;
+    memset(&existing, 0, sizeof(existing));
+    load_mail_config(&existing, "mail.conf");
+    config.smtp_native = existing.smtp_native;
     
     if (save_mail_config(&config, "mail.conf")) {
         printf("\n配置已保存！按回车返回主菜单...");
@@ -154,21 +160,15 @@ static void show_send_page() {
         return;
     }
     
-    // 保存签名到临时文件
-    FILE* fp = fopen("temp_signature.bin", "wb");
-    if (fp) {
-        fwrite(signature, 1, sig_len, fp);
-        fclose(fp);
-    }
-    free(signature);
-    
     // 准备邮件内容
     mail_content_t content = {
         .from = config.username,
         .to = gui_config.to,
         .subject = gui_config.subject,
         .body = gui_config.message,
-        .signature_file = "temp_signature.bin"
+        .signature = signature,
+        .signature_len = sig_len,
+        .signature_alg = sig_alg_name_file("private.pem", 1)
     };
     
     // 发送邮件
@@ -177,8 +177,8 @@ static void show_send_page() {
     } else {
         printf("\n邮件发送失败！按回车返回主菜单...");
     }
+    free(signature);
     
-    remove("temp_signature.bin");
     getchar();
 }
 
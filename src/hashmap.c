@@ -0,0 +1,115 @@
+#include "hashmap.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    char* key;
+    void* value;
+    uint64_t hash;
+} hashmap_entry_t;
+
+struct hashmap {
+    hashmap_entry_t* entries;
+    size_t capacity;  // 总是2的幂
+    size_t size;
+};
+
+// FNV-1a
+static uint64_t hash_string(const char* key) {
+    uint64_t hash = 14695981039346656037ULL;
+    while (*key) {
+        hash ^= (unsigned char)*key++;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static hashmap_entry_t* find_slot(hashmap_entry_t* entries, size_t capacity,
+                                  const char* key, uint64_t hash) {
+    size_t i = hash & (capacity - 1);
+    while (entries[i].key) {
+        if (entries[i].hash == hash && strcmp(entries[i].key, key) == 0) break;
+        i = (i + 1) & (capacity - 1);
+    }
+    return &entries[i];
+}
+
+static int grow(hashmap_t* map) {
+    size_t new_capacity = map->capacity * 2;
+    hashmap_entry_t* entries = calloc(new_capacity, sizeof(hashmap_entry_t));
+    if (!entries) return 0;
+
+    for (size_t i = 0; i < map->capacity; i++) {
+        if (!map->entries[i].key) continue;
+        *find_slot(entries, new_capacity, map->entries[i].key, map->entries[i].hash) = map->entries[i];
+    }
+
+    free(map->entries);
+    map->entries = entries;
+    map->capacity = new_capacity;
+    return 1;
+}
+
+hashmap_t* hashmap_new(size_t capacity) {
+    hashmap_t* map = malloc(sizeof(hashmap_t));
+    if (!map) return NULL;
+
+    // 负载因子保持在1/2以下
+    map->capacity = 16;
+    while (map->capacity < capacity * 2) map->capacity *= 2;
+    map->size = 0;
+    map->entries = calloc(map->capacity, sizeof(hashmap_entry_t));
+    if (!map->entries) {
+        free(map);
+        return NULL;
+    }
+    return map;
+}
+
+int hashmap_put(hashmap_t* map, const char* key, void* value) {
+    if ((map->size + 1) * 2 > map->capacity && !grow(map)) return 0;
+
+    uint64_t hash = hash_string(key);
+    hashmap_entry_t* entry = find_slot(map->entries, map->capacity, key, hash);
+    if (!entry->key) {
+        entry->key = strdup(key);
+        if (!entry->key) return 0;
+        entry->hash = hash;
+        map->size++;
+    }
+    entry->value = value;
+    return 1;
+}
+
+void* hashmap_get(const hashmap_t* map, const char* key) {
+    hashmap_entry_t* entry = find_slot(map->entries, map->capacity, key, hash_string(key));
+    return entry->key ? entry->value : NULL;
+}
+
+int hashmap_contains(const hashmap_t* map, const char* key) {
+    return find_slot(map->entries, map->capacity, key, hash_string(key))->key != NULL;
+}
+
+size_t hashmap_size(const hashmap_t* map) {
+    return map->size;
+}
+
+void hashmap_foreach(const hashmap_t* map,
+                     void (*fn)(const char* key, void* value, void* arg), void* arg) {
+    for (size_t i = 0; i < map->capacity; i++) {
+        if (map->entries[i].key) fn(map->entries[i].key, map->entries[i].value, arg);
+    }
+}
+
+void hashmap_free(hashmap_t* map, void (*free_value)(void*)) {
+    if (!map) return;
+
+    for (size_t i = 0; i < map->capacity; i++) {
+        if (!map->entries[i].key) continue;
+        free(map->entries[i].key);
+        if (free_value) free_value(map->entries[i].value);
+    }
+    free(map->entries);
+    free(map);
+}
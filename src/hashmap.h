@@ -0,0 +1,31 @@
+#ifndef HASHMAP_H
+#define HASHMAP_H
+
+#include <stddef.h>
+
+// 字符串键哈希表(开放寻址)，键由表内部复制保存
+typedef struct hashmap hashmap_t;
+
+// 创建哈希表，capacity为预计元素个数
+hashmap_t* hashmap_new(size_t capacity);
+
+// 插入或替换键值，成功返回1
+int hashmap_put(hashmap_t* map, const char* key, void* value);
+
+// 查找键，不存在返回NULL
+void* hashmap_get(const hashmap_t* map, const char* key);
+
+// 判断键是否存在
+int hashmap_contains(const hashmap_t* map, const char* key);
+
+// 元素个数
+size_t hashmap_size(const hashmap_t* map);
+
+// 遍历所有键值
+void hashmap_foreach(const hashmap_t* map,
+                     void (*fn)(const char* key, void* value, void* arg), void* arg);
+
+// 释放哈希表，free_value不为NULL时用于释放每个值
+void hashmap_free(hashmap_t* map, void (*free_value)(void*));
+
+#endif // HASHMAP_H
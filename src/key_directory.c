@@ -0,0 +1,193 @@
+#include "key_directory.h"
+#include "keyring.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <openssl/pem.h>
+
+#define INDEX_LINE_MAX 1024
+
+// 目录下的文件路径，由调用者free
+static char* dir_path(const char* dir, const char* name) {
+    size_t len = strlen(dir) + strlen(name) + 2;
+    char* path = malloc(len);
+    if (path) snprintf(path, len, "%s/%s", dir, name);
+    return path;
+}
+
+int sender_address(const char* from, size_t from_len, char* address, size_t size) {
+    if (!from) return 0;
+
+    // "显示名 <地址>"取尖括号内，否则整个字段就是地址
+    const char* start = memchr(from, '<', from_len);
+    const char* end = from + from_len;
+    if (start) {
+        start++;
+        const char* close = memchr(start, '>', end - start);
+        if (close) end = close;
+    } else {
+        start = from;
+    }
+    while (start < end && isspace((unsigned char)*start)) start++;
+    while (end > start && isspace((unsigned char)end[-1])) end--;
+
+    size_t len = end - start;
+    if (len == 0 || len >= size || !memchr(start, '@', len)) return 0;
+    for (size_t i = 0; i < len; i++) address[i] = tolower((unsigned char)start[i]);
+    address[len] = '\0';
+    return 1;
+}
+
+// 读取索引：每行"地址 文件名"，格式不对的行忽略
+static void load_index(key_directory_t* keys) {
+    char* index_file = dir_path(keys->dir, KEY_DIR_INDEX);
+    FILE* fp = index_file ? fopen(index_file, "r") : NULL;
+    free(index_file);
+    if (!fp) return;
+
+    char line[INDEX_LINE_MAX];
+    char address[SENDER_ADDRESS_MAX];
+    while (fgets(line, sizeof(line), fp)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        char* name = strchr(line, ' ');
+        if (!name) continue;
+        *name++ = '\0';
+        if (!*name || strchr(name, '/') || !sender_address(line, strlen(line), address, sizeof(address))) continue;
+
+        char* path = dir_path(keys->dir, name);
+        if (!path) continue;
+        // 替换成功后才释放旧路径，hashmap_put失败时表中仍是旧值
+        char* old = hashmap_get(keys->senders, address);
+        if (hashmap_put(keys->senders, address, path)) free(old);
+        else free(path);
+    }
+    fclose(fp);
+}
+
+key_directory_t* key_directory_open(const char* dir, const char* fallback_file) {
+    key_directory_t* keys = calloc(1, sizeof(key_directory_t));
+    if (!keys) return NULL;
+
+    keys->dir = strdup(dir);
+    keys->fallback = fallback_file ? strdup(fallback_file) : NULL;
+    keys->senders = hashmap_new(256);
+    if (!keys->dir || (fallback_file && !keys->fallback) || !keys->senders) {
+        key_directory_free(keys);
+        return NULL;
+    }
+
+    load_index(keys);
+    return keys;
+}
+
+const char* key_directory_file(const key_directory_t* keys, const char* from, size_t from_len) {
+    char address[SENDER_ADDRESS_MAX];
+    const char* path = sender_address(from, from_len, address, sizeof(address))
+        ? hashmap_get(keys->senders, address) : NULL;
+    return path ? path : keys->fallback;
+}
+
+EVP_PKEY* key_directory_get(const key_directory_t* keys, const char* from, size_t from_len) {
+    const char* path = key_directory_file(keys, from, from_len);
+    return path ? keyring_get(keyring_default(), path, KEY_PUBLIC) : NULL;
+}
+
+typedef struct {
+    FILE* fp;
+    size_t prefix;  // 路径中目录部分的长度
+    int ok;
+} index_writer_t;
+
+static void write_index_line(const char* address, void* value, void* arg) {
+    index_writer_t* writer = (index_writer_t*)arg;
+    if (fprintf(writer->fp, "%s %s\n", address, (const char*)value + writer->prefix) < 0) writer->ok = 0;
+}
+
+// 按内存中的映射重写索引：先写临时文件再rename
+static int save_index(const key_directory_t* keys) {
+    char* index_file = dir_path(keys->dir, KEY_DIR_INDEX);
+    char* tmp_file = dir_path(keys->dir, KEY_DIR_INDEX ".tmp");
+    FILE* fp = tmp_file ? fopen(tmp_file, "w") : NULL;
+    int ok = 0;
+
+    if (fp && index_file) {
+        index_writer_t writer = { fp, strlen(keys->dir) + 1, 1 };
+        hashmap_foreach(keys->senders, write_index_line, &writer);
+        ok = fclose(fp) == 0 && writer.ok && rename(tmp_file, index_file) == 0;
+    } else if (fp) {
+        fclose(fp);
+    }
+    if (!ok && tmp_file) remove(tmp_file);
+
+    free(index_file);
+    free(tmp_file);
+    return ok;
+}
+
+int key_directory_add(key_directory_t* keys, const char* address, const char* public_key_file) {
+    char normalized[SENDER_ADDRESS_MAX];
+    if (!sender_address(address, strlen(address), normalized, sizeof(normalized))) return 0;
+
+    EVP_PKEY* pkey = keyring_get(keyring_default(), public_key_file, KEY_PUBLIC);
+    if (!pkey) return 0;
+
+    // 文件名取规范化地址的SHA-256，不同地址不会映射到同一个文件
+    // (只保留安全字符时a+b@x.com和a_b@x.com会互相覆盖)
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int digest_len = 0;
+    if (!EVP_Digest(normalized, strlen(normalized), digest, &digest_len, EVP_sha256(), NULL)) {
+        EVP_PKEY_free(pkey);
+        return 0;
+    }
+    char name[EVP_MAX_MD_SIZE * 2 + 8];
+    for (unsigned int i = 0; i < digest_len; i++) snprintf(name + i * 2, 3, "%02x", digest[i]);
+    memcpy(name + digest_len * 2, ".pem", 5);
+
+    char* path = dir_path(keys->dir, name);
+    mkdir(keys->dir, 0700);
+    FILE* fp = path ? fopen(path, "w") : NULL;
+    int ok = fp && PEM_write_PUBKEY(fp, pkey);
+    if (fp && fclose(fp) != 0) ok = 0;
+    EVP_PKEY_free(pkey);
+
+    if (ok) {
+        char* old = hashmap_get(keys->senders, normalized);
+        ok = hashmap_put(keys->senders, normalized, path);
+        if (ok) {
+            free(old);
+            path = NULL;
+        }
+    }
+    free(path);
+    return ok && save_index(keys);
+}
+
+void key_directory_free(key_directory_t* keys) {
+    if (!keys) return;
+
+    if (keys->senders) hashmap_free(keys->senders, free);
+    free(keys->dir);
+    free(keys->fallback);
+    free(keys);
+}
+
+static key_directory_t* default_keys = NULL;
+static pthread_once_t default_once = PTHREAD_ONCE_INIT;
+
+static void free_default_keys(void) {
+    key_directory_free(default_keys);
+    default_keys = NULL;
+}
+
+static void init_default_keys(void) {
+    default_keys = key_directory_open(KEY_DIR, DEFAULT_PUBLIC_KEY);
+    if (default_keys) atexit(free_default_keys);
+}
+
+key_directory_t* key_directory_default(void) {
+    pthread_once(&default_once, init_default_keys);
+    return default_keys;
+}
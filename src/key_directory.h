@@ -0,0 +1,41 @@
+#ifndef KEY_DIRECTORY_H
+#define KEY_DIRECTORY_H
+
+#include <stddef.h>
+#include <openssl/evp.h>
+#include "hashmap.h"
+
+#define KEY_DIR "keys"                   // 发件人公钥目录
+#define KEY_DIR_INDEX "index"            // 目录下的索引文件，每行"发件人地址 公钥文件名"
+#define DEFAULT_PUBLIC_KEY "public.pem"  // 索引中没有的发件人使用的公钥
+#define SENDER_ADDRESS_MAX 256
+
+// 按发件人地址查找公钥。索引在打开时一次读入哈希表，之后只读，可以被多个线程共享
+typedef struct {
+    char* dir;
+    char* fallback;      // 索引中没有发件人时使用的公钥文件，可以为NULL
+    hashmap_t* senders;  // 小写发件人地址 -> 公钥文件路径
+} key_directory_t;
+
+// 打开公钥目录，目录或索引不存在时得到空目录(只使用fallback_file)
+key_directory_t* key_directory_open(const char* dir, const char* fallback_file);
+
+// 从From头中取出地址并转成小写，如"Zhang <Zhang@Example.com>"得到"zhang@example.com"。
+// 没有地址或地址超长返回0
+int sender_address(const char* from, size_t from_len, char* address, size_t size);
+
+// 发件人对应的公钥文件，索引中没有时返回fallback，都没有返回NULL
+const char* key_directory_file(const key_directory_t* keys, const char* from, size_t from_len);
+
+// 通过默认密钥缓存取发件人公钥，用完后EVP_PKEY_free；找不到或加载失败返回NULL
+EVP_PKEY* key_directory_get(const key_directory_t* keys, const char* from, size_t from_len);
+
+// 导入发件人公钥：复制到目录中并更新索引，已有的同一发件人会被替换
+int key_directory_add(key_directory_t* keys, const char* address, const char* public_key_file);
+
+void key_directory_free(key_directory_t* keys);
+
+// 进程内共享的默认公钥目录(KEY_DIR，找不到发件人时使用DEFAULT_PUBLIC_KEY)
+key_directory_t* key_directory_default(void);
+
+#endif // KEY_DIRECTORY_H
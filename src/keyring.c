@@ -0,0 +1,116 @@
+#include "keyring.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <openssl/crypto.h>
+#include <openssl/pem.h>
+
+// 一个已解析的密钥及加载时的文件状态
+typedef struct {
+    EVP_PKEY* pkey;
+    struct timespec mtime;
+    off_t size;
+} keyring_entry_t;
+
+static void free_entry(void* value) {
+    keyring_entry_t* entry = (keyring_entry_t*)value;
+    EVP_PKEY_free(entry->pkey);
+    free(entry);
+}
+
+keyring_t* keyring_new(void) {
+    keyring_t* ring = malloc(sizeof(keyring_t));
+    if (!ring) return NULL;
+
+    ring->keys = hashmap_new(8);
+    if (!ring->keys) {
+        free(ring);
+        return NULL;
+    }
+    pthread_mutex_init(&ring->lock, NULL);
+    ring->loads = 0;
+    ring->hits = 0;
+    return ring;
+}
+
+static EVP_PKEY* load_key(const char* key_file, key_type_t type) {
+    FILE* fp = fopen(key_file, "r");
+    if (!fp) return NULL;
+
+    EVP_PKEY* pkey = type == KEY_PRIVATE
+        ? PEM_read_PrivateKey(fp, NULL, NULL, NULL)
+        : PEM_read_PUBKEY(fp, NULL, NULL, NULL);
+    fclose(fp);
+    return pkey;
+}
+
+EVP_PKEY* keyring_get(keyring_t* ring, const char* key_file, key_type_t type) {
+    struct stat st;
+    if (stat(key_file, &st) != 0) return NULL;
+
+    char name[4096];
+    snprintf(name, sizeof(name), "%s:%s", type == KEY_PRIVATE ? "priv" : "pub", key_file);
+
+    pthread_mutex_lock(&ring->lock);
+
+    keyring_entry_t* entry = hashmap_get(ring->keys, name);
+    if (entry && entry->size == st.st_size
+        && entry->mtime.tv_sec == st.st_mtim.tv_sec && entry->mtime.tv_nsec == st.st_mtim.tv_nsec) {
+        ring->hits++;
+    } else {
+        // 首次使用或文件已更新，重新解析
+        EVP_PKEY* pkey = load_key(key_file, type);
+        if (!pkey) {
+            pthread_mutex_unlock(&ring->lock);
+            return NULL;
+        }
+        if (!entry) {
+            entry = calloc(1, sizeof(keyring_entry_t));
+            if (!entry || !hashmap_put(ring->keys, name, entry)) {
+                free(entry);
+                EVP_PKEY_free(pkey);
+                pthread_mutex_unlock(&ring->lock);
+                return NULL;
+            }
+        }
+        EVP_PKEY_free(entry->pkey);
+        entry->pkey = pkey;
+        entry->mtime = st.st_mtim;
+        entry->size = st.st_size;
+        ring->loads++;
+    }
+
+    EVP_PKEY* pkey = entry->pkey;
+    EVP_PKEY_up_ref(pkey);
+    pthread_mutex_unlock(&ring->lock);
+    return pkey;
+}
+
+void keyring_free(keyring_t* ring) {
+    if (!ring) return;
+
+    hashmap_free(ring->keys, free_entry);
+    pthread_mutex_destroy(&ring->lock);
+    free(ring);
+}
+
+static keyring_t* default_ring = NULL;
+static pthread_once_t default_once = PTHREAD_ONCE_INIT;
+
+static void free_default_ring(void) {
+    keyring_free(default_ring);
+    default_ring = NULL;
+}
+
+static void init_default_ring(void) {
+    // 先初始化OpenSSL，保证退出时在OpenSSL自身清理之前释放缓存的密钥
+    OPENSSL_init_crypto(0, NULL);
+    default_ring = keyring_new();
+    if (default_ring) atexit(free_default_ring);
+}
+
+keyring_t* keyring_default(void) {
+    pthread_once(&default_once, init_default_ring);
+    return default_ring;
+}
@@ -0,0 +1,34 @@
+#ifndef KEYRING_H
+#define KEYRING_H
+
+#include <pthread.h>
+#include <openssl/evp.h>
+#include "hashmap.h"
+
+// 密钥类型
+typedef enum {
+    KEY_PUBLIC,
+    KEY_PRIVATE
+} key_type_t;
+
+// 解析后的密钥缓存：每个PEM文件只解析一次，文件修改时间或大小变化时才重新加载。
+// 可以被多个线程共享
+typedef struct {
+    hashmap_t* keys;  // "pub:路径"/"priv:路径" -> keyring_entry_t
+    pthread_mutex_t lock;
+    size_t loads;     // PEM实际解析次数
+    size_t hits;      // 命中缓存次数
+} keyring_t;
+
+keyring_t* keyring_new(void);
+
+// 取密钥句柄，返回的EVP_PKEY已增加引用计数，用完后EVP_PKEY_free；
+// 重新加载不会影响已经取出的句柄。文件不存在或解析失败返回NULL
+EVP_PKEY* keyring_get(keyring_t* ring, const char* key_file, key_type_t type);
+
+void keyring_free(keyring_t* ring);
+
+// 进程内共享的默认密钥缓存，按路径签名/验签的接口都通过它取密钥
+keyring_t* keyring_default(void);
+
+#endif // KEYRING_H
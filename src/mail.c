@@ -1,38 +1,17 @@
 #include "mail.h"
 #include "base64.h"
+#include "crypto.h"
+#include "mime_builder.h"
+#include "mail_sender.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
 #include <time.h>
+#include <openssl/rand.h>
 
-#define MAX_PAYLOAD_SIZE 1024*1024  // 1MB
 #define CONFIG_LINE_MAX 256
 
-// 用于存储邮件内容的结构体
-typedef struct {
-    char* data;
-    size_t size;
-} upload_ctx_t;
-
-// libcurl回调函数，用于读取要发送的数据
-static size_t payload_source(void* ptr, size_t size, size_t nmemb, void* userp) {
-    upload_ctx_t* ctx = (upload_ctx_t*)userp;
-    size_t available = ctx->size;
-    size_t can_copy = size * nmemb;
-
-    if (available < can_copy)
-        can_copy = available;
-
-    if (can_copy > 0) {
-        memcpy(ptr, ctx->data, can_copy);
-        ctx->data += can_copy;
-        ctx->size -= can_copy;
-        return can_copy;
-    }
-
-    return 0;
-}
-
 int mail_init() {
     return curl_global_init(CURL_GLOBAL_DEFAULT);
 }
@@ -41,108 +20,251 @@ void mail_cleanup() {
     curl_global_cleanup();
 }
 
-// 生成MIME邮件内容
-static char* generate_mime_message(const mail_content_t* content) {
-    char* mime = malloc(MAX_PAYLOAD_SIZE);
+// 读取整个签名文件，失败返回NULL，由调用者free
+static unsigned char* read_signature_file(const char* path, size_t* len) {
+    FILE* fp = fopen(path, "rb");
+    if (!fp) return NULL;
+
+    unsigned char* signature = NULL;
+    long size = -1;
+    if (fseek(fp, 0, SEEK_END) == 0 && (size = ftell(fp)) > 0 && fseek(fp, 0, SEEK_SET) == 0) {
+        signature = malloc(size);
+        if (signature && fread(signature, 1, size, fp) != (size_t)size) {
+            free(signature);
+            signature = NULL;
+        }
+    }
+    fclose(fp);
+
+    *len = signature ? (size_t)size : 0;
+    return signature;
+}
+
+// 路径中的文件名部分
+static const char* file_basename(const char* path) {
+    const char* slash = strrchr(path, '/');
+    return slash ? slash + 1 : path;
+}
+
+char* mail_signed_body(const char* body, const char* const* attachments, int count) {
+    // 每行: 固定前缀 + 文件名 + 空格 + 64位十六进制摘要 + CRLF
+    size_t len = strlen(body) + 3;
+    for (int i = 0; i < count; i++) {
+        len += strlen(ATTACHMENT_DIGEST_PREFIX) + strlen(file_basename(attachments[i])) + 1 + EVP_MAX_MD_SIZE * 2 + 2;
+    }
+
+    char* signed_body = malloc(len);
+    if (!signed_body) return NULL;
+    size_t offset = snprintf(signed_body, len, "%s%s", body, count ? "\r\n" : "");
+
+    for (int i = 0; i < count; i++) {
+        unsigned char digest[EVP_MAX_MD_SIZE];
+        unsigned int digest_len = 0;
+        if (!calculate_digest_file(attachments[i], digest, &digest_len)) {
+            free(signed_body);
+            return NULL;
+        }
+
+        offset += snprintf(signed_body + offset, len - offset, "\r\n%s%s ",
+                           ATTACHMENT_DIGEST_PREFIX, file_basename(attachments[i]));
+        for (unsigned int j = 0; j < digest_len; j++) {
+            offset += snprintf(signed_body + offset, len - offset, "%02x", digest[j]);
+        }
+    }
+    return signed_body;
+}
+
+int mail_new_message_id(char* out, size_t size) {
+    unsigned char nonce[16];
+    if (size < MAIL_MESSAGE_ID_MAX || RAND_bytes(nonce, sizeof(nonce)) != 1) return 0;
+
+    char* p = out;
+    *p++ = '<';
+    for (size_t i = 0; i < sizeof(nonce); i++) p += snprintf(p, 3, "%02x", nonce[i]);
+    snprintf(p, size - (p - out), "@crymail>");
+    return 1;
+}
+
+// 解析一行"Attachment-SHA256: 文件名 摘要"，文件名须为name，摘要写入digest(MIME_DIGEST_LEN字节)
+static int parse_digest_line(const char* line, size_t len, const char* name, size_t name_len,
+                             unsigned char* digest) {
+    size_t prefix = strlen(ATTACHMENT_DIGEST_PREFIX);
+    if (len != prefix + name_len + 1 + MIME_DIGEST_LEN * 2
+        || memcmp(line, ATTACHMENT_DIGEST_PREFIX, prefix) != 0
+        || memcmp(line + prefix, name, name_len) != 0 || line[prefix + name_len] != ' ') {
+        return 0;
+    }
+    const char* hex = line + prefix + name_len + 1;
+    for (int j = 0; j < MIME_DIGEST_LEN; j++) {
+        unsigned int byte;
+        if (!isxdigit((unsigned char)hex[j * 2]) || !isxdigit((unsigned char)hex[j * 2 + 1])
+            || sscanf(hex + j * 2, "%2x", &byte) != 1) {
+            return 0;
+        }
+        digest[j] = byte;
+    }
+    return 1;
+}
+
+int mail_attachment_digest(const mail_content_t* content, int index, unsigned char* digest) {
+    // 摘要行在正文末尾，第index个附件是倒数第attachment_count-index行
+    const char* body = content->body;
+    const char* end = body + strlen(body);
+    for (int i = content->attachment_count - 1; i >= index; i--) {
+        const char* line = end;
+        while (line > body && line[-1] != '\n') line--;
+        if (i > index) {
+            if (line - body < 2 || line[-2] != '\r') return 0;
+            end = line - 2;
+            continue;
+        }
+
+        const char* name = file_basename(content->attachments[index]);
+        return parse_digest_line(line, end - line, name, strlen(name), digest);
+    }
+    return 0;
+}
+
+int mail_verify_attachments(const char* body, size_t body_len, const mail_attachment_t* attachments) {
+    int count = 0;
+    for (const mail_attachment_t* attachment = attachments; attachment; attachment = attachment->next) count++;
+
+    // 从最后一行往前核对，最后一行对应最后一个附件；收到的附件核对完后，
+    // 前一行不能还是摘要行(签名时的附件比收到的多)
+    const char* end = body + body_len;
+    for (int i = count - 1; i >= -1; i--) {
+        const char* line = end;
+        while (line > body && line[-1] != '\n') line--;
+
+        size_t prefix = strlen(ATTACHMENT_DIGEST_PREFIX);
+        if (i < 0) return (size_t)(end - line) < prefix || memcmp(line, ATTACHMENT_DIGEST_PREFIX, prefix) != 0;
+
+        const mail_attachment_t* attachment = attachments;
+        for (int j = 0; j < i; j++) attachment = attachment->next;
+
+        unsigned char digest[MIME_DIGEST_LEN];
+        if (!attachment->has_digest
+            || !parse_digest_line(line, end - line, attachment->name, strlen(attachment->name), digest)
+            || memcmp(digest, attachment->digest, MIME_DIGEST_LEN) != 0) {
+            return 0;
+        }
+
+        if (line == body) return i == 0;
+        end = line - 1;
+        if (end > body && end[-1] == '\r') end--;
+    }
+    return 1;
+}
+
+// 生成MIME邮件：正文只引用content->body，附件在发送时从文件分块读出流式编码，
+// 签名编码到builder的内存池中
+mime_builder_t* generate_mime_message(const mail_content_t* content) {
+    mime_builder_t* mime = mime_builder_new();
+    if (!mime) return NULL;
+
     time_t now = time(NULL);
     char date[128];
     strftime(date, sizeof(date), "%a, %d %b %Y %H:%M:%S %z", localtime(&now));
 
-    // 构建MIME消息头
-    int offset = snprintf(mime, MAX_PAYLOAD_SIZE,
+    // 构建MIME消息头，密送地址不写入邮件头
+    int ok = (!content->message_id || mime_builder_printf(mime, "Message-ID: %s\r\n", content->message_id))
+          && mime_builder_printf(mime,
         "Date: %s\r\n"
         "To: %s\r\n"
-        "From: %s\r\n"
+        "From: %s\r\n",
+        date, content->to, content->from)
+          && (!content->cc || !*content->cc || mime_builder_printf(mime, "Cc: %s\r\n", content->cc))
+          && mime_builder_printf(mime,
         "Subject: %s\r\n"
         "MIME-Version: 1.0\r\n"
         "Content-Type: multipart/mixed; boundary=\"boundary\"\r\n"
         "\r\n"
         "--boundary\r\n"
         "Content-Type: text/plain; charset=\"utf-8\"\r\n"
-        "\r\n"
-        "%s\r\n",
-        date, content->to, content->from, content->subject, content->body);
-
-    // 如果有签名文件，添加签名附件
-    if (content->signature_file) {
-        FILE* fp = fopen(content->signature_file, "rb");
-        if (fp) {
-            fseek(fp, 0, SEEK_END);
-            long sig_size = ftell(fp);
-            fseek(fp, 0, SEEK_SET);
-
-            unsigned char* signature = malloc(sig_size);
-            fread(signature, 1, sig_size, fp);
-            fclose(fp);
-
-            offset += snprintf(mime + offset, MAX_PAYLOAD_SIZE - offset,
-                "\r\n--boundary\r\n"
-                "Content-Type: application/octet-stream\r\n"
-                "Content-Transfer-Encoding: base64\r\n"
-                "Content-Disposition: attachment; filename=\"signature.bin\"\r\n"
-                "\r\n");
-
-            // Base64编码签名
-            size_t base64_len;
-            char* base64_sig = malloc(sig_size * 2);  // 足够大的空间
-            base64_encode(signature, sig_size, base64_sig, &base64_len);
-
-            offset += snprintf(mime + offset, MAX_PAYLOAD_SIZE - offset,
-                "%s\r\n", base64_sig);
+        "\r\n",
+        content->subject);
+    ok = ok && mime_builder_add(mime, content->body, strlen(content->body))
+            && mime_builder_add(mime, "\r\n", 2);
+
+    for (int i = 0; ok && i < content->attachment_count; i++) {
+        // 签名覆盖的是mail_signed_body时的附件摘要，发送时对编码的字节再核对一次
+        unsigned char digest[MIME_DIGEST_LEN];
+        int has_digest = mail_attachment_digest(content, i, digest);
+        ok = mime_builder_printf(mime,
+            "\r\n--boundary\r\n"
+            "Content-Type: application/octet-stream\r\n"
+            "Content-Transfer-Encoding: base64\r\n"
+            "Content-Disposition: attachment; filename=\"%s\"\r\n"
+            "\r\n",
+            file_basename(content->attachments[i]))
+          && mime_builder_add_file(mime, content->attachments[i], has_digest ? digest : NULL)
+          && mime_builder_add(mime, "\r\n", 2);
+        if (!ok) fprintf(stderr, "无法读取附件%s\n", content->attachments[i]);
+    }
 
-            free(signature);
-            free(base64_sig);
-        }
+    // 签名直接取内存中的字节，只给了签名文件时才读文件
+    unsigned char* file_signature = NULL;
+    const unsigned char* signature = content->signature;
+    size_t sig_size = content->signature_len;
+    if (!signature && content->signature_file) {
+        file_signature = read_signature_file(content->signature_file, &sig_size);
+        signature = file_signature;
     }
 
-    offset += snprintf(mime + offset, MAX_PAYLOAD_SIZE - offset,
-        "\r\n--boundary--\r\n");
+    if (ok && signature) {
+        ok = mime_builder_printf(mime,
+            "\r\n--boundary\r\n"
+            "Content-Type: application/octet-stream\r\n"
+            "Content-Transfer-Encoding: base64\r\n"
+            "Content-Disposition: attachment; filename=\"signature.bin\"\r\n"
+            SIGNATURE_ALG_HEADER ": %s\r\n"
+            "\r\n",
+            content->signature_alg ? content->signature_alg : SIG_ALG_RSA_SHA256);
+
+        // Base64编码签名，按RFC 2045每76个字符换行
+        base64_encoder_t encoder;
+        base64_encoder_init(&encoder, BASE64_LINE_MAX);
+        char* base64_sig = arena_alloc(mime->arena, base64_encoded_max(sig_size, BASE64_LINE_MAX) + 2);
+        if (ok && base64_sig) {
+            size_t base64_len = base64_encode_update(&encoder, signature, sig_size, base64_sig);
+            base64_len += base64_encode_final(&encoder, base64_sig + base64_len);
+            memcpy(base64_sig + base64_len, "\r\n", 2);
+            ok = mime_builder_add(mime, base64_sig, base64_len + 2);
+        } else {
+            ok = 0;
+        }
+    }
+    free(file_signature);
 
+    ok = ok && mime_builder_printf(mime, "\r\n--boundary--\r\n");
+    if (!ok) {
+        mime_builder_free(mime);
+        return NULL;
+    }
     return mime;
 }
 
-int send_signed_mail(const mail_config_t* config, const mail_content_t* content) {
-    CURL* curl = curl_easy_init();
-    if (!curl) return 0;
-
-    // 生成MIME消息
-    char* mime_message = generate_mime_message(content);
-    upload_ctx_t upload_ctx = { mime_message, strlen(mime_message) };
-
-    struct curl_slist* recipients = NULL;
-    recipients = curl_slist_append(recipients, content->to);
-
-    char url[256];
-    snprintf(url, sizeof(url), "%s://%s:%d",
-        config->use_ssl ? "smtps" : "smtp",
-        config->smtp_server,
-        config->port);
-
-    // 设置CURL选项
-    curl_easy_setopt(curl, CURLOPT_URL, url);
-    curl_easy_setopt(curl, CURLOPT_MAIL_FROM, content->from);
-    curl_easy_setopt(curl, CURLOPT_MAIL_RCPT, recipients);
-    curl_easy_setopt(curl, CURLOPT_USERNAME, config->username);
-    curl_easy_setopt(curl, CURLOPT_PASSWORD, config->password);
-    curl_easy_setopt(curl, CURLOPT_USE_SSL, config->use_ssl ? CURLUSESSL_ALL : CURLUSESSL_NONE);
-    curl_easy_setopt(curl, CURLOPT_READFUNCTION, payload_source);
-    curl_easy_setopt(curl, CURLOPT_READDATA, &upload_ctx);
-    curl_easy_setopt(curl, CURLOPT_UPLOAD, 1L);
- 
-    // 发送邮件
-    CURLcode res = curl_easy_perform(curl);
-
-    if (res != CURLE_OK) {
-        fprintf(stderr, "curl_easy_perform() failed: %s\n", curl_easy_strerror(res));
+// 记下部分投递失败时还需要重试的收件人
+static void keep_retry(void* user, const mail_sender_result_t* result, void* arg) {
+    (void)user;
+    char** retry = (char**)arg;
+    if (!result->ok && result->retry && (result->delivered || result->rejected)) {
+        *retry = strdup(result->retry);
     }
+}
 
+int send_signed_mail_ex(const mail_config_t* config, const mail_content_t* content, char** retry) {
+    if (retry) *retry = NULL;
+    mail_sender_t* sender = mail_sender_new(config, 1, retry ? keep_retry : NULL, retry);
+    if (!sender) return 0;
 
-    // 清理
-    curl_slist_free_all(recipients);
-    curl_easy_cleanup(curl);
-    free(mime_message);
+    int ok = mail_sender_queue(sender, content, NULL) && mail_sender_run(sender);
+    mail_sender_free(sender);
+    return ok;
+}
 
-    return (res == CURLE_OK);
+int send_signed_mail(const mail_config_t* config, const mail_content_t* content) {
+    return send_signed_mail_ex(config, content, NULL);
 }
 
 int save_mail_config(const mail_config_t* config, const char* config_file) {
@@ -154,6 +276,7 @@ int save_mail_config(const mail_config_t* config, const char* config_file) {
     fprintf(fp, "password=%s\n", config->password);
     fprintf(fp, "port=%d\n", config->port);
     fprintf(fp, "use_ssl=%d\n", config->use_ssl);
+    fprintf(fp, "smtp_engine=%s\n", config->smtp_native ? "native" : "curl");
     fprintf(fp, "pop3_server=%s\n", config->pop3_server);
     fprintf(fp, "pop3_port=%d\n", config->pop3_port);
     fprintf(fp, "pop3_use_ssl=%d\n", config->pop3_use_ssl);
@@ -168,6 +291,7 @@ int load_mail_config(mail_config_t* config, const char* config_file) {
 
     char line[CONFIG_LINE_MAX];
     char* value;
+    config->smtp_native = 0;
 
     while (fgets(line, sizeof(line), fp)) {
         value = strchr(line, '=');
@@ -185,6 +309,8 @@ int load_mail_config(mail_config_t* config, const char* config_file) {
             config->port = atoi(value);
         else if (strcmp(line, "use_ssl") == 0)
             config->use_ssl = atoi(value);
+        else if (strcmp(line, "smtp_engine") == 0)
+            config->smtp_native = strcmp(value, "native") == 0;
         else if (strcmp(line, "pop3_server") == 0)
             config->pop3_server = strdup(value);
         else if (strcmp(line, "pop3_port") == 0)
@@ -2,6 +2,8 @@
 #define MAIL_H
 
 #include <curl/curl.h>
+#include "arena.h"
+#include "mime_builder.h"
 
 // 邮件配置结构体
 typedef struct {
@@ -10,6 +12,7 @@ typedef struct {
     const char* password;
     int port;
     int use_ssl;
+    int smtp_native;  // 1: 用内置的SMTP客户端(PIPELINING/CHUNKING)发送，0: 用libcurl
     // 添加POP3/IMAP配置
     const char* pop3_server;
     int pop3_port;
@@ -19,30 +22,79 @@ typedef struct {
 // 邮件内容结构体
 typedef struct {
     const char* from;
-    const char* to;
+    const char* to;   // 收件人，多个地址用逗号分隔
+    const char* cc;   // 抄送，可以为NULL
+    const char* bcc;  // 密送，只在SMTP事务中出现，不写入邮件头，可以为NULL
+    const char* envelope;  // 实际投递的收件人，为NULL时是To、Cc、Bcc中的全部地址；只重发部分收件人时使用
     const char* subject;
     const char* body;
+    const char* message_id;  // 为NULL时不写Message-ID头，见mail_new_message_id
+    const unsigned char* signature;  // 内存中的签名，不为NULL时优先于signature_file
+    size_t signature_len;
     const char* signature_file;  // 签名文件路径
+    const char* signature_alg;   // 签名算法标记，NULL时为rsa-sha256
+    const char* const* attachments;  // 附件文件路径，发送时流式编码
+    int attachment_count;
 } mail_content_t;
 
+// 收到的一个附件，节点分配在邮件列表的内存池中
+typedef struct mail_attachment {
+    char* name;
+    unsigned char digest[MIME_DIGEST_LEN];  // 解码后内容的SHA-256
+    int has_digest;  // 0表示内容不是合法的base64
+    struct mail_attachment* next;
+} mail_attachment_t;
+
 // 邮件列表项结构体
 typedef struct {
-    char* uid;
+    char* uid;          // POP3 UIDL，服务器不支持时为Message-ID
+    char* message_id;
+    int msg_num;        // 本次会话中的POP3邮件序号
     char* from;
     char* subject;
     char* date;
-    int has_signature;  // 是否包含数字签名
+    int has_signature;  // 是否包含数字签名，MAIL_SIGNATURE_UNKNOWN表示只取了邮件头，无法判断
     char* body;
     char* signature_file;
     size_t signature_file_len; 
+    char* signature_alg;  // 签名附件的X-Signature-Alg，旧格式邮件没有此字段时为NULL
+    mail_attachment_t* attachments;  // 签名以外的附件，按邮件中的顺序
+    int complete;       // 0表示只下载了邮件头(TOP)，需要RETR获取完整内容
+    int verify_status;  // 批量验签结果MAIL_SIG_*
 } mail_item_t;
 
-// 邮件列表结构体
+// 邮件列表结构体，邮件项中的字符串都分配在arena中
 typedef struct {
     mail_item_t* items;
     int count;
+    arena_t* arena;
+    int connect_count;  // 本次同步建立的POP3连接数
+    int login_count;    // 本次同步的登录次数
+    size_t bytes_received;  // 本次同步接收的字节数
+    int skipped_count;  // 按UIDL跳过的已同步邮件数
 } mail_list_t;
 
+// 验签结果
+#define MAIL_SIG_UNCHECKED 0  // 尚未验签(或只下载了邮件头，无法验签)
+#define MAIL_SIG_UNSIGNED  1  // 没有签名
+#define MAIL_SIG_VERIFIED  2  // 验签通过
+#define MAIL_SIG_FAILED    3  // 签名与内容不符
+#define MAIL_SIG_INVALID   4  // 签名无法解码，或签名算法与公钥类型不一致
+#define MAIL_SIG_NO_KEY    5  // 找不到发件人的公钥
+
+// TOP的预览行没有读到multipart邮件的结尾，签名附件可能在后面
+#define MAIL_SIGNATURE_UNKNOWN (-1)
+
+// 签名附件中标记签名格式的头字段
+#define SIGNATURE_ALG_HEADER "X-Signature-Alg"
+
+// 正文中附件摘要行的前缀，见mail_signed_body
+#define ATTACHMENT_DIGEST_PREFIX "Attachment-SHA256: "
+
+// 邮件列表模式
+#define MAIL_LIST_HEADERS 0  // 仅用TOP获取邮件头，选中后再RETR
+#define MAIL_LIST_FULL    1  // 每封邮件都RETR完整下载
+
 // 初始化邮件系统
 int mail_init();
 
@@ -52,9 +104,51 @@ void mail_cleanup();
 // 发送签名邮件
 int send_signed_mail(const mail_config_t* config, const mail_content_t* content);
 
-// 接收邮件列表
+// 同send_signed_mail。失败时如果已有收件人投递成功或被永久拒绝，*retry为其余还需要重试的收件人
+// (逗号分隔，可能为空串)，由调用者free；否则*retry为NULL，应整封重试
+int send_signed_mail_ex(const mail_config_t* config, const mail_content_t* content, char** retry);
+
+// 生成MIME邮件：正文和附件只被引用，邮件头和签名格式化到builder的内存池中。
+// 由调用者mime_builder_free
+mime_builder_t* generate_mime_message(const mail_content_t* content);
+
+// 批量发送：任务文件每行"收件人<TAB>主题<TAB>正文"，正文中可用\n、\t、\\转义，
+// 空行和#开头的行忽略。先用threads个线程批量签名，再通过connections个并发SMTP会话发送，
+// 每个会话复用一个连接；最后报告每个连接和总的吞吐量以及单封延迟。全部成功返回1
+int send_bulk_mail(const mail_config_t* config, const char* job_file, int threads, int connections);
+
+// 生成要签名并发送的正文：原正文后面逐行附上"Attachment-SHA256: 文件名 摘要"，
+// 签名覆盖这份正文，也就覆盖了附件内容。没有附件时返回正文副本，附件读取失败返回NULL。
+// 由调用者free
+char* mail_signed_body(const char* body, const char* const* attachments, int count);
+
+// 从mail_signed_body生成的正文中取第index个附件签名时的摘要(MIME_DIGEST_LEN字节)，
+// 正文末尾没有对应的摘要行返回0
+int mail_attachment_digest(const mail_content_t* content, int index, unsigned char* digest);
+
+// 核对收到的附件：签名覆盖的正文末尾的摘要行须与attachments按顺序逐一对应(文件名和摘要都一致)，
+// 附件多出、缺少或内容不符都返回0。签名只覆盖正文，附件是否被篡改要靠这一步
+int mail_verify_attachments(const char* body, size_t body_len, const mail_attachment_t* attachments);
+
+#define MAIL_MESSAGE_ID_MAX 64
+
+// 生成新的Message-ID("<32位随机十六进制@crymail>")，out至少MAIL_MESSAGE_ID_MAX字节。
+// 同一封邮件的重发应沿用第一次生成的值
+int mail_new_message_id(char* out, size_t size);
+
+// 接收邮件列表(仅邮件头模式)
 mail_list_t* receive_mail_list(const mail_config_t* config);
 
+// 按指定模式接收邮件列表
+mail_list_t* receive_mail_list_ex(const mail_config_t* config, int mode);
+
+// 离线查看本地邮件库(mail.store/mail.idx)，config为NULL时不联网补全只有邮件头的邮件
+int list_local_mail(const mail_config_t* config);
+
+// 用线程池校验本地邮件库中所有邮件的签名并汇总，threads<=0时使用CPU数。
+// 全部通过(或没有签名)返回1
+int audit_local_mail(int threads);
+
 // 接收指定邮件的完整内容
 mail_content_t* receive_mail_content(const mail_config_t* config, const char* uid);
 
@@ -0,0 +1,205 @@
+#include "mail.h"
+#include "crypto.h"
+#include "keyring.h"
+#include "mail_sender.h"
+#include "arena.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BULK_ARENA_BLOCK (64 * 1024)
+
+// 任务文件中的一封邮件
+typedef struct {
+    const char* to;
+    const char* subject;
+    const char* body;
+} bulk_job_t;
+
+typedef struct {
+    arena_t* arena;
+    bulk_job_t* jobs;
+    size_t count;
+    size_t cap;
+} bulk_list_t;
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// 就地还原\n、\t、\\转义
+static void unescape(char* text) {
+    char* out = text;
+    for (char* p = text; *p; p++) {
+        if (*p == '\\' && p[1]) {
+            p++;
+            *out++ = *p == 'n' ? '\n' : *p == 't' ? '\t' : *p;
+        } else {
+            *out++ = *p;
+        }
+    }
+    *out = '\0';
+}
+
+// 解析一行"收件人<TAB>主题<TAB>正文"，格式不对返回0
+static int parse_job_line(bulk_list_t* list, char* line) {
+    line[strcspn(line, "\r\n")] = '\0';
+    if (!line[0] || line[0] == '#') return 1;
+
+    char* subject = strchr(line, '\t');
+    char* body = subject ? strchr(subject + 1, '\t') : NULL;
+    if (!body) return 0;
+    *subject++ = '\0';
+    *body++ = '\0';
+    unescape(body);
+
+    if (list->count == list->cap) {
+        size_t cap = list->cap ? list->cap * 2 : 256;
+        bulk_job_t* jobs = realloc(list->jobs, cap * sizeof(bulk_job_t));
+        if (!jobs) return 0;
+        list->jobs = jobs;
+        list->cap = cap;
+    }
+
+    bulk_job_t* job = &list->jobs[list->count];
+    job->to = arena_strdup(list->arena, line);
+    job->subject = arena_strdup(list->arena, subject);
+    job->body = arena_strdup(list->arena, body);
+    if (!job->to || !job->subject || !job->body) return 0;
+    list->count++;
+    return 1;
+}
+
+static int load_jobs(bulk_list_t* list, const char* job_file) {
+    FILE* fp = fopen(job_file, "r");
+    if (!fp) return 0;
+
+    char* line = NULL;
+    size_t size = 0;
+    int line_num = 0, ok = 1;
+    while (ok && getline(&line, &size, fp) != -1) {
+        line_num++;
+        if (!parse_job_line(list, line)) {
+            printf("任务文件第%d行格式错误，应为: 收件人<TAB>主题<TAB>正文\n", line_num);
+            ok = 0;
+        }
+    }
+    free(line);
+    fclose(fp);
+    return ok;
+}
+
+// 发送结果：失败的邮件延迟记为负数
+static void record_latency(void* user, const mail_sender_result_t* result, void* arg) {
+    double* latencies = (double*)arg;
+    latencies[(size_t)user] = result->ok ? result->seconds * 1000 : -1;
+}
+
+static int compare_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// 有序数组的百分位数
+static double percentile(const double* sorted, size_t count, double p) {
+    size_t i = (size_t)(p * (count - 1) + 0.5);
+    return sorted[i < count ? i : count - 1];
+}
+
+int send_bulk_mail(const mail_config_t* config, const char* job_file, int threads, int connections) {
+    bulk_list_t list = { arena_new(BULK_ARENA_BLOCK), NULL, 0, 0 };
+    if (!list.arena || !load_jobs(&list, job_file) || list.count == 0) {
+        if (list.count == 0) printf("任务文件%s中没有要发送的邮件\n", job_file);
+        arena_free(list.arena);
+        free(list.jobs);
+        return 0;
+    }
+
+    EVP_PKEY* pkey = keyring_get(keyring_default(), "private.pem", KEY_PRIVATE);
+    sign_input_t* inputs = malloc(list.count * sizeof(sign_input_t));
+    sign_output_t* outputs = calloc(list.count, sizeof(sign_output_t));
+    double* latencies = malloc(list.count * sizeof(double));
+    mail_sender_t* sender = NULL;
+    int ok = 0;
+
+    if (!pkey) {
+        printf("无法加载私钥private.pem\n");
+        goto cleanup;
+    }
+    if (!inputs || !outputs || !latencies) goto cleanup;
+
+    // 先多线程批量签名，发送阶段只剩网络传输
+    for (size_t i = 0; i < list.count; i++) {
+        inputs[i].data = list.jobs[i].body;
+        inputs[i].len = strlen(list.jobs[i].body);
+    }
+    double start = now_seconds();
+    size_t signed_count = sign_batch(pkey, inputs, list.count, threads, 0, outputs);
+    double sign_seconds = now_seconds() - start;
+    if (signed_count != list.count) {
+        printf("签名失败%zu封，停止发送\n", list.count - signed_count);
+        goto cleanup;
+    }
+
+    sender = mail_sender_new(config, connections, record_latency, latencies);
+    if (!sender) goto cleanup;
+
+    for (size_t i = 0; i < list.count; i++) {
+        mail_content_t content = {
+            .from = config->username,
+            .to = list.jobs[i].to,
+            .subject = list.jobs[i].subject,
+            .body = list.jobs[i].body,
+            .signature = outputs[i].signature,
+            .signature_len = outputs[i].len,
+            .signature_alg = sig_alg_name(pkey)
+        };
+        if (!mail_sender_queue(sender, &content, (void*)i)) {
+            printf("无法生成发送给%s的邮件\n", list.jobs[i].to);
+            goto cleanup;
+        }
+    }
+    mail_sender_run(sender);
+
+    // 失败的邮件逐封列出，成功的延迟移到数组前部统计
+    size_t timed = 0;
+    for (size_t i = 0; i < list.count; i++) {
+        if (latencies[i] < 0) printf("发送给%s的邮件失败\n", list.jobs[i].to);
+        else latencies[timed++] = latencies[i];
+    }
+
+    const mail_sender_stats_t* total = &sender->total;
+    printf("%6s %8s %8s %9s %10s\n", "conn", "sent", "failed", "connects", "msgs/s");
+    for (int i = 0; i < sender->conn_count; i++) {
+        const mail_sender_stats_t* stats = &sender->conns[i].stats;
+        printf("%6d %8zu %8zu %9zu %10.1f\n", i + 1, stats->sent, stats->failed, stats->connects,
+               stats->busy > 0 ? stats->sent / stats->busy : 0);
+    }
+    printf("共%zu封: 发送成功%zu, 失败%zu, 建立连接%zu次, 上传%zu字节\n",
+           list.count, total->sent, total->failed, total->connects, total->bytes);
+    printf("签名用时%.3f秒, 发送用时%.3f秒(%d个连接), %.1f封/秒\n",
+           sign_seconds, sender->elapsed, sender->conn_count, total->sent / sender->elapsed);
+    if (timed > 0) {
+        qsort(latencies, timed, sizeof(double), compare_double);
+        double sum = 0;
+        for (size_t i = 0; i < timed; i++) sum += latencies[i];
+        printf("单封延迟(毫秒): 平均%.2f, 中位%.2f, p99 %.2f, 最大%.2f\n",
+               sum / timed, percentile(latencies, timed, 0.5),
+               percentile(latencies, timed, 0.99), latencies[timed - 1]);
+    }
+    ok = total->failed == 0 && total->sent == list.count;
+
+cleanup:
+    mail_sender_free(sender);
+    if (outputs) sign_batch_free(outputs, list.count);
+    free(outputs);
+    free(inputs);
+    free(latencies);
+    EVP_PKEY_free(pkey);
+    arena_free(list.arena);
+    free(list.jobs);
+    return ok;
+}
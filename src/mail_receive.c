@@ -3,8 +3,19 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
+#include <time.h>
 #include <curl/curl.h>
 #include "crypto.h"
+#include "keyring.h"
+#include "key_directory.h"
+#include "mail_verify.h"
+#include "thread_pool.h"
+#include "hashmap.h"
+#include "mail_store.h"
+#include "mime_parser.h"
+#include "arena.h"
+#include "mail_view.h"
 
 // 用于存储接收到的数据的结构体
 typedef struct {
@@ -12,31 +23,9 @@ typedef struct {
     size_t size;
 } receive_ctx_t;
 
-void trim_body(char** body) {
-    if (*body == NULL) {
-        return;
-    }
-
-    // 移动指针移去前导空行和横杠
-    char* start = *body;
-    while (*start) {
-        if (*start == '\n' || *start == '\r' || *start == '-') {
-            start++;
-        } else {
-            break;
-        }
-    }
-
-    // 去除尾部空行和横杠
-    char* end = start + strlen(start) - 1;
-    while (end > start && (*end == '\n' || *end == '\r' || *end == '-')) {
-        end--;
-    }
-    *(end + 1) = '\0';
-
-    // 更新 body 指向去掉多余空行和分隔符的内容
-    *body = strdup(start);
-}
+// 仅邮件头模式下TOP附带的正文行数，正文较短时可以覆盖签名附件的part头，
+// 没有覆盖到时签名标为未知
+#define LIST_PREVIEW_LINES 20
 
 // libcurl写入回调函数
 static size_t write_callback(void* contents, size_t size, size_t nmemb, void* userp) {
@@ -54,22 +43,218 @@ static size_t write_callback(void* contents, size_t size, size_t nmemb, void* us
     return realsize;
 }
 
-// 帮助函数：提取字段值，处理行匹配和字符串拷贝
-static char* get_field_value(const char* line, const char* field_name) {
-    size_t field_len = strlen(field_name);
-    if (strncmp(line, field_name, field_len) == 0) {
-        // 跳过字段名部分并去除多余的空格
-        const char* value_start = line + field_len;
-        while (*value_start == ' ' || *value_start == '\t') {
-            value_start++;
+// 解析邮件内容
+static mail_content_t* parse_mail_content(const char* data) {
+    mail_content_t* content = calloc(1, sizeof(mail_content_t));
+    
+    // 这里需要根据POP3/IMAP协议解析邮件内容
+    // 这是一个简化的示例
+    content->from = strdup("");
+    content->to = strdup("");
+    content->subject = strdup("");
+    content->body = strdup(data);
+    content->signature_file = NULL;
+
+    return content;
+}
+
+// POP3会话：整个邮箱同步复用同一个curl句柄，libcurl会保持连接并跳过重复登录
+typedef struct {
+    CURL* curl;
+    const mail_config_t* config;
+    int connect_count;  // 新建TCP/TLS连接次数
+    int login_count;    // USER/PASS登录次数
+    size_t bytes_received;  // 收到的响应字节数
+    size_t (*write_fn)(void*, size_t, size_t, void*);  // 当前请求的数据处理函数
+    void* write_data;
+} pop3_session_t;
+
+// 统计接收字节数后转给当前请求的处理函数
+static size_t session_write_callback(void* contents, size_t size, size_t nmemb, void* userp) {
+    pop3_session_t* session = (pop3_session_t*)userp;
+    size_t written = session->write_fn(contents, size, nmemb, session->write_data);
+    session->bytes_received += written;
+    return written;
+}
+
+static int pop3_session_open(pop3_session_t* session, const mail_config_t* config) {
+    session->curl = curl_easy_init();
+    session->config = config;
+    session->connect_count = 0;
+    session->login_count = 0;
+    session->bytes_received = 0;
+    if (!session->curl) return 0;
+
+    curl_easy_setopt(session->curl, CURLOPT_USERNAME, config->username);
+    curl_easy_setopt(session->curl, CURLOPT_PASSWORD, config->password);
+    curl_easy_setopt(session->curl, CURLOPT_USE_SSL, CURLUSESSL_ALL);
+    // curl_easy_setopt(session->curl, CURLOPT_VERBOSE, 1L);
+    return 1;
+}
+
+// 在会话上执行一条POP3命令，path为邮件序号(可为空)，command为NULL时由libcurl决定(LIST/RETR)，
+// 响应数据交给write_fn处理
+static CURLcode pop3_session_perform(pop3_session_t* session, const char* path, const char* command,
+                                     size_t (*write_fn)(void*, size_t, size_t, void*),
+                                     void* userdata) {
+    const mail_config_t* config = session->config;
+    char url[256];
+    snprintf(url, sizeof(url), "%s://%s:%d/%s",
+             config->pop3_use_ssl ? "pop3s" : "pop3",
+             config->pop3_server,
+             config->pop3_port, path);
+
+    curl_easy_setopt(session->curl, CURLOPT_URL, url);
+    session->write_fn = write_fn;
+    session->write_data = userdata;
+    curl_easy_setopt(session->curl, CURLOPT_WRITEFUNCTION, session_write_callback);
+    curl_easy_setopt(session->curl, CURLOPT_WRITEDATA, session);
+    curl_easy_setopt(session->curl, CURLOPT_CUSTOMREQUEST, command);
+
+    CURLcode res = curl_easy_perform(session->curl);
+
+    // 每个新连接都会重新走一次USER/PASS认证
+    long new_connects = 0;
+    curl_easy_getinfo(session->curl, CURLINFO_NUM_CONNECTS, &new_connects);
+    session->connect_count += new_connects;
+    session->login_count += new_connects;
+
+    return res;
+}
+
+// 执行一条POP3命令并把完整响应收进缓冲区(UIDL/LIST等小响应)
+static CURLcode pop3_session_request(pop3_session_t* session, const char* path,
+                                     const char* command, receive_ctx_t* ctx) {
+    return pop3_session_perform(session, path, command, write_callback, ctx);
+}
+
+static void pop3_session_close(pop3_session_t* session) {
+    if (session->curl) {
+        curl_easy_cleanup(session->curl);
+        session->curl = NULL;
+    }
+}
+
+// 统计LIST响应中的邮件数量(每行"序号 大小")
+static int count_list_lines(const char* data) {
+    int count = 0;
+    const char* line = data;
+    while (line && *line) {
+        if (*line >= '0' && *line <= '9') count++;
+        line = strchr(line, '\n');
+        if (line) line++;
+    }
+    return count;
+}
+
+// 每个邮件列表的内存池块大小，解析出的所有字符串都从这里分配
+#define MAIL_ARENA_BLOCK (64 * 1024)
+
+static mail_list_t* new_mail_list() {
+    mail_list_t* list = calloc(1, sizeof(mail_list_t));
+    if (!list) return NULL;
+
+    list->arena = arena_new(MAIL_ARENA_BLOCK);
+    if (!list->arena) {
+        free(list);
+        return NULL;
+    }
+    return list;
+}
+
+// 流式接收上下文：libcurl每收到一块数据就喂给MIME解析器，同时原样追加到本地邮件库，
+// 内存中只保留正在解析的行和需要输出的部分，不再缓存整封邮件
+typedef struct {
+    mime_parser_t parser;
+    mail_item_t item;
+    arena_t* arena;       // 所属邮件列表的内存池
+    mail_store_t* store;  // 不需要保存时为NULL
+    int error;
+} stream_ctx_t;
+
+// 把需要的邮件头字段填进邮件项，value为原始字段值(可能含折行)
+static void set_mail_field(arena_t* arena, mail_item_t* item, const char* name, size_t name_len,
+                           const char* value, size_t value_len) {
+    char** field = NULL;
+
+    if (mime_name_is(name, name_len, "Message-ID")) field = &item->message_id;
+    else if (mime_name_is(name, name_len, "From")) field = &item->from;
+    else if (mime_name_is(name, name_len, "Date")) field = &item->date;
+    else if (mime_name_is(name, name_len, "Subject")) field = &item->subject;
+
+    if (field && !*field && (*field = arena_alloc(arena, value_len + 1))) {
+        mime_unfold_to(*field, value, value_len);
+    }
+}
+
+// 把正文或签名部分填进邮件项，裁剪规则与零拷贝视图一致
+static void set_mail_part(arena_t* arena, mail_item_t* item, mime_part_kind_t kind,
+                          const char* data, size_t len) {
+    mail_span_t span = { 0, len };
+
+    if (kind == MIME_PART_TEXT && !item->body) {
+        mail_span_trim_body(data, &span);
+        item->body = arena_strndup(arena, data + span.off, span.len);
+    } else if (kind == MIME_PART_SIGNATURE) {
+        mail_span_trim_signature(data, &span);
+        item->has_signature = 1;
+        item->signature_file = arena_strndup(arena, data, span.len);
+        item->signature_file_len = span.len;
+    }
+}
+
+// MIME解析事件：把需要的字段填进邮件项
+static void stream_event(mime_event_t event, const char* name,
+                         const char* data, size_t len, void* arg) {
+    stream_ctx_t* ctx = (stream_ctx_t*)arg;
+
+    switch (event) {
+    case MIME_HEADER:
+        set_mail_field(ctx->arena, &ctx->item, name, strlen(name), data, len);
+        break;
+    case MIME_PART_HEADER:
+        if (!ctx->item.signature_alg && mime_name_is(name, strlen(name), SIGNATURE_ALG_HEADER)) {
+            ctx->item.signature_alg = arena_strndup(ctx->arena, data, len);
         }
-        // 返回字段值的副本
-        return strdup(value_start);
+        break;
+    case MIME_TEXT:
+        set_mail_part(ctx->arena, &ctx->item, MIME_PART_TEXT, data, len);
+        break;
+    case MIME_SIGNATURE:
+        set_mail_part(ctx->arena, &ctx->item, MIME_PART_SIGNATURE, data, len);
+        break;
+    case MIME_ATTACHMENT:
+        // 分配失败时少记的附件会让验签失败而不是通过
+        mail_attachment_append(ctx->arena, &ctx->item.attachments, name, strlen(name),
+                               (const unsigned char*)data, len);
+        break;
+    default:
+        break;
     }
-    return NULL;
 }
 
-// 核心解析函数
+static size_t stream_write_callback(void* contents, size_t size, size_t nmemb, void* userp) {
+    size_t realsize = size * nmemb;
+    stream_ctx_t* ctx = (stream_ctx_t*)userp;
+
+    if (!mime_parser_feed(&ctx->parser, contents, realsize)) return 0;
+    if (ctx->store && !ctx->error && !mail_store_append(ctx->store, contents, realsize)) {
+        ctx->error = 1;  // 落盘失败不影响本次显示
+    }
+    return realsize;
+}
+
+// 缺失的邮件头用占位内容填充
+static void finish_mail_item(arena_t* arena, mail_item_t* item) {
+    if (!item->message_id) item->message_id = arena_strdup(arena, "No Message-ID");
+    if (!item->from) item->from = arena_strdup(arena, "No From");
+    if (!item->date) item->date = arena_strdup(arena, "No Date");
+    if (!item->subject) item->subject = arena_strdup(arena, "No Subject");
+    if (!item->body) item->body = arena_strdup(arena, "");
+}
+
+// 核心解析函数：解析已经完整在内存中的邮件(例如本地邮件库中的)。
+// 先建立零拷贝视图，再把各字段一次性复制到列表的内存池里
 void parse_mail_list(mail_list_t* list, const char* data, int index) {
     // 确保有足够的空间
     if (index >= list->count) {
@@ -79,266 +264,560 @@ void parse_mail_list(mail_list_t* list, const char* data, int index) {
 
     // 指向当前解析的邮件项
     mail_item_t* item = &list->items[index];
-    
-    item->uid = NULL;
-    item->from = NULL;
-    item->subject = NULL;
-    item->date = NULL;
-    item->has_signature = 0;
-    item->body = NULL;
-    item->signature_file = NULL;
-    item->signature_file_len = 0;
-
-    // 解析 UID
-    const char* uid_tag = "\nMessage-ID: ";
-    char* uid_start = strstr(data, uid_tag);
-    if (uid_start) {
-        uid_start += strlen(uid_tag);
-        char* uid_end = strstr(uid_start, "\r\n");
-        size_t uid_length = uid_end ? uid_end - uid_start : strlen(uid_start);
-        item->uid = malloc(uid_length + 1);
-        strncpy(item->uid, uid_start, uid_length);
-        item->uid[uid_length] = '\0';
-    } else {
-        item->uid = strdup("No UID");
-    }
-
-    // 解析发件人
-    const char* from_tag = "\nFrom: ";
-    char* from_start = strstr(data, from_tag);
-    if (from_start) {
-        from_start += strlen(from_tag);
-        char* from_end = strstr(from_start, "\r\n");
-        size_t from_length = from_end ? from_end - from_start : strlen(from_start);
-        item->from = malloc(from_length + 1);
-        strncpy(item->from, from_start, from_length);
-        item->from[from_length] = '\0';
-    } else {
-        item->from = strdup("No From");
-    }
-
-    // 解析日期
-    const char* date_tag = "\nDate: ";
-    char* date_start = strstr(data, date_tag);
-    if (date_start) {
-        date_start += strlen(date_tag);
-        char* date_end = strstr(date_start, "\r\n");
-        size_t date_length = date_end ? date_end - date_start : strlen(date_start);
-        item->date = malloc(date_length + 1);
-        strncpy(item->date, date_start, date_length);
-        item->date[date_length] = '\0';
-    } else {
-        item->date = strdup("No Date");
-    }
-
-    // 解析主题
-    const char* subject_tag = "\nSubject: ";
-    char* subject_start = strstr(data, subject_tag);
-    if (subject_start) {
-        subject_start += strlen(subject_tag);
-        char* subject_end = strstr(subject_start, "\r\n");
-        size_t subject_length = subject_end ? subject_end - subject_start : strlen(subject_start);
-        item->subject = malloc(subject_length + 1);
-        strncpy(item->subject, subject_start, subject_length);
-        item->subject[subject_length] = '\0';
-    } else {
-        item->subject = strdup("No Subject");
+    memset(item, 0, sizeof(mail_item_t));
+    item->msg_num = index + 1;
+    item->complete = 1;
+
+    mail_view_t view;
+    mail_view_parse(&view, data, strlen(data));
+    mail_view_materialize(&view, list->arena, item);
+}
+
+// 在会话上下载序号为msg_num的邮件并解析到列表第index项，store不为NULL时同时存入本地邮件库：
+// 完整模式用RETR，仅邮件头模式用TOP只取头部和少量正文行。uid为服务器UIDL，可为NULL
+static CURLcode fetch_mail_item(pop3_session_t* session, mail_list_t* list, int index,
+                                int msg_num, const char* uid, int mode, mail_store_t* store) {
+    stream_ctx_t ctx;
+    char path[32];
+    CURLcode res;
+
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.arena = list->arena;
+    mime_parser_init(&ctx.parser, stream_event, &ctx);
+    ctx.item.complete = (mode == MAIL_LIST_FULL);
+    // 没有UIDL时要等解析出Message-ID才知道是否已保存，先照常写入
+    if (store && (!uid || mail_store_wants(store, uid, ctx.item.complete)) && mail_store_begin(store)) {
+        ctx.store = store;
     }
 
-    const char* body_start = strstr(data, "\r\n\r\n");
-    if (body_start) {
-        body_start += strlen("\r\n\r\n");
+    if (mode == MAIL_LIST_HEADERS) {
+        // TOP不能带在URL路径里，libcurl会拼成"TOP n"而缺少行数参数
+        char command[64];
+        snprintf(command, sizeof(command), "TOP %d %d", msg_num, LIST_PREVIEW_LINES);
+        res = pop3_session_perform(session, "", command, stream_write_callback, &ctx);
     } else {
-        body_start = data;
+        snprintf(path, sizeof(path), "%d", msg_num);
+        res = pop3_session_perform(session, path, "RETR", stream_write_callback, &ctx);
     }
 
-    const char* boundary_tag_start = strstr(data, "Content-Type: multipart/mixed; boundary=");
-    if (boundary_tag_start != NULL) {
-        boundary_tag_start += strlen("Content-Type: multipart/mixed; boundary=");
-        char boundary[256];
-        sscanf(boundary_tag_start, "\"%255[^\"]\"", boundary);
+    if (res == CURLE_OK && !mime_parser_finish(&ctx.parser)) {
+        res = CURLE_OUT_OF_MEMORY;
+    }
+    // 预览行在multipart邮件结束前截断时没见到签名不代表没有签名
+    if (!ctx.item.complete && !ctx.item.has_signature && ctx.parser.boundary[0] && !ctx.parser.closed) {
+        ctx.item.has_signature = MAIL_SIGNATURE_UNKNOWN;
+    }
+    mime_parser_free(&ctx.parser);
 
-        char delimiter[256];
-        snprintf(delimiter, sizeof(delimiter), "--%s", boundary);
+    // 失败时已分配的字段留在内存池里，随列表一起释放；
+    // 已写入邮件库的部分没有索引记录指向，截掉
+    mail_item_t* item = &ctx.item;
+    if (res != CURLE_OK) {
+        if (ctx.store) mail_store_abort(store);
+        return res;
+    }
 
-        char* part_start = strstr(body_start, delimiter);
-        while (part_start) {
-            part_start += strlen(delimiter);
-            if (strncmp(part_start, "--", 2) == 0) {
-                break;
-            }
+    finish_mail_item(list->arena, item);
+    item->msg_num = msg_num;
+    item->uid = arena_strdup(list->arena, uid ? uid : item->message_id);
 
-            const char* text_start_tag = "Content-Type: text/plain;";
-            if ((part_start = strstr(part_start, text_start_tag)) != NULL) {
-                part_start = strstr(part_start, "\r\n\r\n");
-                if (part_start) {
-                    part_start += strlen("\r\n\r\n");
-                    char* next_part_start = strstr(part_start, delimiter);
-                    size_t part_length = next_part_start ? (next_part_start - part_start) : strlen(part_start);
-                    item->body = malloc(part_length + 1);
-                    strncpy(item->body, part_start, part_length);
-                    item->body[part_length] = '\0';
-
-                    trim_body(&item->body);
-                }
-            }
+    // 没有UIDL的邮件解析出Message-ID后才知道是否已保存，不需要或写入失败时同样截掉
+    if (ctx.store) {
+        int wanted = !ctx.error && (uid || mail_store_wants(store, item->uid, item->complete));
+        if (wanted && !mail_store_commit(store, item)) {
+            printf("邮件 %s 写入本地邮件库失败\n", item->uid);
+            wanted = 0;
+        }
+        if (!wanted) mail_store_abort(store);
+    }
 
-            const char* signature_tag = "Content-Disposition: attachment; filename=\"signature.bin\"\r\n\r\n";
-            if ((part_start = strstr(part_start, signature_tag)) != NULL) {
-                item->has_signature = 1;
-                const char* signature_start = part_start + strlen(signature_tag);
-                char* next_part_start = strstr(signature_start, delimiter);
-                size_t signature_len = next_part_start ? (next_part_start - signature_start) : strlen(signature_start);
-
-                // 去除末尾的空行和横杠
-                char* signature_end = (char *)(signature_start + signature_len - 1);
-                while (signature_end > signature_start && (*signature_end == '\n' || *signature_end == '\r' || *signature_end == '-' || *signature_end == ' ')) {
-                    signature_end--;
-                }
-                *(signature_end + 1) = '\0';
-
-                item->signature_file = strdup(signature_start);
-                item->signature_file_len = strlen(item->signature_file);
-            }
+    if (index >= list->count) {
+        list->items = realloc(list->items, sizeof(mail_item_t) * (index + 1));
+        list->count = index + 1;
+    }
+    list->items[index] = *item;
+    return res;
+}
 
-            part_start = strstr(part_start, delimiter);
+// UIDL响应中的一项
+typedef struct {
+    int msg_num;
+    char uid[71];  // RFC 1939: UID最长70个字符
+    int synced;    // 本地状态文件中已记录
+} uidl_entry_t;
+
+// 解析UIDL响应(每行"序号 UID")，返回条目数
+static int parse_uidl(const char* data, uidl_entry_t** entries) {
+    int capacity = 0, count = 0;
+    *entries = NULL;
+
+    const char* line = data;
+    while (line && *line) {
+        uidl_entry_t entry = { 0 };
+        if (sscanf(line, "%d %70s", &entry.msg_num, entry.uid) == 2) {
+            if (count == capacity) {
+                capacity = capacity ? capacity * 2 : 64;
+                *entries = realloc(*entries, sizeof(uidl_entry_t) * capacity);
+            }
+            (*entries)[count++] = entry;
         }
-    } else {
-        if (body_start) {
-            item->body = strdup(body_start);
-            trim_body(&item->body);
+        line = strchr(line, '\n');
+        if (line) line++;
+    }
+    return count;
+}
+
+// 读取本地已同步的UID集合
+static hashmap_t* load_uidl_state(const char* state_file) {
+    hashmap_t* known = hashmap_new(256);
+    FILE* fp = fopen(state_file, "r");
+    if (!fp) return known;
+
+    char line[128];
+    while (fgets(line, sizeof(line), fp)) {
+        line[strcspn(line, "\r\n")] = 0;
+        if (line[0]) hashmap_put(known, line, NULL);
+    }
+    fclose(fp);
+    return known;
+}
+
+// 服务器上已删除的邮件不再需要记录，用临时文件+rename整体重写状态文件
+static void save_uidl_state(const char* state_file, const uidl_entry_t* entries, int count) {
+    char tmp_file[256];
+    snprintf(tmp_file, sizeof(tmp_file), "%s.tmp", state_file);
+
+    FILE* fp = fopen(tmp_file, "w");
+    if (!fp) return;
+    for (int i = 0; i < count; i++) {
+        if (entries[i].synced) fprintf(fp, "%s\n", entries[i].uid);
+    }
+    if (fclose(fp) == 0) {
+        rename(tmp_file, state_file);
+    }
+}
+
+// 用发件人的公钥解码base64签名并对长度为body_len的正文验签，再核对附件摘要，打印结果。
+// alg为签名附件标记的算法，没有标记的旧邮件按RSA双重摘要格式验证
+static void verify_and_report(const char* from, const char* body, size_t body_len,
+                              const char* signature, size_t sig_len,
+                              const char* alg, size_t alg_len,
+                              const mail_attachment_t* attachments) {
+    key_directory_t* keys = key_directory_default();
+    EVP_PKEY* pkey = keys ? key_directory_get(keys, from, strlen(from)) : NULL;
+    if (!pkey) {
+        printf("找不到发件人%s的公钥，不进行验签\n", from);
+        return;
+    }
+
+    switch (mail_verify_signature(NULL, pkey, body, body_len, signature, sig_len, alg, alg_len)) {
+    case MAIL_SIG_VERIFIED:
+        if (mail_verify_attachments(body, body_len, attachments)) {
+            printf("验签成功！消息真实\n");
         } else {
-            item->body = strdup("No Body");
+            printf("签名验证失败！附件与签名时的摘要不符，可能被篡改。\n");
         }
+        break;
+    case MAIL_SIG_FAILED:
+        printf("签名验证失败！消息可能被篡改。\n");
+        break;
+    default:
+        printf("签名无法解码，或签名算法%.*s与公钥类型不一致，无法验签\n",
+               (int)(alg_len ? alg_len : strlen(SIG_ALG_RSA_SHA256)), alg_len ? alg : SIG_ALG_RSA_SHA256);
+        break;
     }
+    EVP_PKEY_free(pkey);
 }
 
-// 解析邮件内容
-static mail_content_t* parse_mail_content(const char* data) {
-    mail_content_t* content = malloc(sizeof(mail_content_t));
-    
-    // 这里需要根据POP3/IMAP协议解析邮件内容
-    // 这是一个简化的示例
-    content->from = strdup("");
-    content->to = strdup("");
-    content->subject = strdup("");
-    content->body = strdup(data);
-    content->signature_file = NULL;
+// 列表中的签名标志：1有签名，0没有，?为只取了邮件头无法判断
+static const char* signature_mark(int has_signature) {
+    return has_signature > 0 ? "1" : has_signature < 0 ? "?" : "0";
+}
 
-    return content;
+// 索引记录标志对应的has_signature
+static int record_signature(uint32_t flags) {
+    if (flags & MAIL_RECORD_SIGNED) return 1;
+    return (flags & MAIL_RECORD_SIGNATURE_UNKNOWN) ? MAIL_SIGNATURE_UNKNOWN : 0;
+}
+
+// 本地邮件库中已有的邮件直接用索引记录列出，不再TOP；正文没有载入，选中时再RETR
+static void list_stored_item(mail_list_t* list, int msg_num, const char* uid, const mail_record_t* record) {
+    int index = list->count;
+    list->items = realloc(list->items, sizeof(mail_item_t) * (index + 1));
+    list->count = index + 1;
+
+    mail_item_t* item = &list->items[index];
+    memset(item, 0, sizeof(*item));
+    item->msg_num = msg_num;
+    item->uid = arena_strdup(list->arena, uid);
+    item->from = record->from[0] ? arena_strdup(list->arena, record->from) : NULL;
+    item->date = record->date[0] ? arena_strdup(list->arena, record->date) : NULL;
+    item->subject = record->subject[0] ? arena_strdup(list->arena, record->subject) : NULL;
+    item->has_signature = record_signature(record->flags);
+    finish_mail_item(list->arena, item);
+}
+
+// 显示一封邮件的详细信息，完整下载且有签名时解码并验签
+static void show_mail_item(const mail_item_t* item, int mail_num) {
+    printf("Email #%d: Date: %s From: %s Subject: %s\n", 
+           mail_num, item->date, item->from, item->subject);
+    printf("Content: %s\n", item->body);
+
+    if (!item->has_signature) {
+        printf("没有签名,不进行验签\n");
+        return;
+    }
+    // 只有邮件头时签名可能还没读到，正文也是截断的
+    if (item->has_signature < 0 || !item->complete) {
+        printf("只下载了邮件头，无法验签\n");
+        return;
+    }
+
+    printf("Signature: %s\n", item->signature_file);
+    verify_and_report(item->from, item->body, strlen(item->body), item->signature_file, item->signature_file_len,
+                      item->signature_alg, item->signature_alg ? strlen(item->signature_alg) : 0,
+                      item->attachments);
+}
+
+// 展开折行后的邮件头字段，不存在时用占位内容，由调用者free
+static char* view_field(const mail_view_t* view, mail_span_t span, const char* fallback) {
+    return span.len ? mail_view_dup(view, span) : strdup(fallback);
+}
+
+// 直接在原始邮件上显示并验签：正文和签名不复制，只有很短的邮件头需要展开折行
+static void show_mail_view(const mail_view_t* view, int mail_num) {
+    char* date = view_field(view, view->date, "No Date");
+    char* from = view_field(view, view->from, "No From");
+    char* subject = view_field(view, view->subject, "No Subject");
+    printf("Email #%d: Date: %s From: %s Subject: %s\n", mail_num, date, from, subject);
+    free(date);
+    free(subject);
+
+    const char* body = mail_span_ptr(view, view->body);
+    printf("Content: %.*s\n", (int)view->body.len, body);
+
+    if (!view->has_signature) {
+        printf("没有签名,不进行验签\n");
+    } else {
+        const char* signature = mail_span_ptr(view, view->signature);
+        printf("Signature: %.*s\n", (int)view->signature.len, signature);
+
+        // 附件只在验签时解码一遍算出摘要
+        arena_t* arena = arena_new(4096);
+        mail_attachment_t* attachments = NULL;
+        if (arena && mail_view_attachments(view, arena, &attachments)) {
+            verify_and_report(from, body, view->body.len, signature, view->signature.len,
+                              mail_span_ptr(view, view->signature_alg), view->signature_alg.len, attachments);
+        } else {
+            printf("内存不足，无法验签\n");
+        }
+        arena_free(arena);
+    }
+    free(from);
 }
 
-#define MAX_MAIL_COUNT 32
+#define MAX_MAIL_COUNT 32  // 每次同步最多下载的新邮件数
+#define UIDL_STATE_FILE "uidl.state"
 mail_list_t* receive_mail_list(const mail_config_t* config) {
-    CURL* curl;
+    return receive_mail_list_ex(config, MAIL_LIST_HEADERS);
+}
+
+mail_list_t* receive_mail_list_ex(const mail_config_t* config, int mode) {
     CURLcode res;
-    mail_list_t* list = malloc(sizeof(mail_list_t));
-    list->count = 0;
-    list->items = NULL; // 初始化为空
-
-    for (size_t i = 1; i <= MAX_MAIL_COUNT; ++i) {  // 假设只获取2封邮件，你可以根据需要修改这个数字
-        curl = curl_easy_init();
-        if (!curl) {
-            printf("CURL init failed!\n");
-            free(list->items);
-            free(list);
-            return NULL;
-        }
+    mail_list_t* list = new_mail_list();
+    if (!list) return NULL;
 
-        receive_ctx_t ctx = { NULL, 0 };
-        char url[256];
-        snprintf(url, sizeof(url), "%s://%s:%d/%zu", // 获取第i封邮件
-                 config->pop3_use_ssl ? "pop3s" : "pop3",
-                 config->pop3_server,
-                 config->pop3_port, i);
-
-        curl_easy_setopt(curl, CURLOPT_URL, url);
-        curl_easy_setopt(curl, CURLOPT_USERNAME, config->username);
-        curl_easy_setopt(curl, CURLOPT_PASSWORD, config->password);
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &ctx);
-        curl_easy_setopt(curl, CURLOPT_USE_SSL, CURLUSESSL_ALL);
-        // curl_easy_setopt(curl, CURLOPT_VERBOSE, 1L);
-        curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "RETR");
-
-        res = curl_easy_perform(curl);
-        curl_easy_cleanup(curl);
+    pop3_session_t session;
+    if (!pop3_session_open(&session, config)) {
+        printf("CURL init failed!\n");
+        free_mail_list(list);
+        return NULL;
+    }
 
+    // 一次UIDL同时拿到邮件数量和唯一标识，服务器不支持UIDL时退回LIST
+    uidl_entry_t* uidls = NULL;
+    int mail_count = 0;
+    receive_ctx_t list_ctx = { NULL, 0 };
+    res = pop3_session_request(&session, "", "UIDL", &list_ctx);
+    if (res == CURLE_OK) {
+        mail_count = list_ctx.data ? parse_uidl(list_ctx.data, &uidls) : 0;
+    } else {
+        free(list_ctx.data);
+        list_ctx.data = NULL;
+        list_ctx.size = 0;
+        res = pop3_session_request(&session, "", NULL, &list_ctx);
+        mail_count = (res == CURLE_OK && list_ctx.data) ? count_list_lines(list_ctx.data) : 0;
         if (res != CURLE_OK) {
-            // printf("Failed to retrieve email %zu: %s\n", i, curl_easy_strerror(res));
-            free(ctx.data);
-            break;
+            printf("Failed to list mailbox: %s\n", curl_easy_strerror(res));
         }
+    }
+    free(list_ctx.data);
+
+    // 已同步过的UID直接跳过，新邮件完整下载后立即追加到状态文件；
+    // 只取了邮件头的邮件不记录，下次同步仍会列出，直到被选中完整下载
+    hashmap_t* known = load_uidl_state(UIDL_STATE_FILE);
+    size_t known_count = hashmap_size(known);
+    FILE* state_fp = uidls ? fopen(UIDL_STATE_FILE, "a") : NULL;
+    mail_store_t* store = mail_store_open(MAIL_STORE_FILE, MAIL_INDEX_FILE);
+    if (!store) {
+        printf("无法打开本地邮件库，本次同步不做本地保存\n");
+    }
 
-        parse_mail_list(list, ctx.data, i - 1);
-        printf("[Email #%zu] Date: %s From: %s Subject: %s has_signature: %d\n", 
-               i, list->items[i - 1].date, list->items[i - 1].from, 
-               list->items[i - 1].subject, list->items[i - 1].has_signature);
+    // 先标出状态文件中已有的UID，下载中途失败退出循环时它们也会保留在重写的状态文件里
+    for (int i = 0; uidls && i < mail_count; ++i) {
+        if (hashmap_contains(known, uidls[i].uid)) {
+            uidls[i].synced = 1;
+            list->skipped_count++;
+        }
+    }
 
-        free(ctx.data);
+    int fetched = 0;
+    for (int i = 0; i < mail_count; ++i) {
+        int msg_num = uidls ? uidls[i].msg_num : i + 1;
+        const char* uid = uidls ? uidls[i].uid : NULL;
+
+        if (uid && uidls[i].synced) continue;
+
+        // 上次已取过邮件头的直接从索引记录列出，不占下载名额，后面的新邮件才轮得到
+        int index = list->count;
+        mail_record_t record;
+        if (mode == MAIL_LIST_HEADERS && uid && store && mail_store_get(store, uid, &record)) {
+            list_stored_item(list, msg_num, uid, &record);
+        } else {
+            if (fetched >= MAX_MAIL_COUNT) continue;  // 剩下的留到下次同步
+
+            res = fetch_mail_item(&session, list, index, msg_num, uid, mode, store);  // 获取第msg_num封邮件
+            if (res != CURLE_OK) {
+                // printf("Failed to retrieve email %d: %s\n", msg_num, curl_easy_strerror(res));
+                break;
+            }
+            fetched++;
+        }
+
+        if (state_fp && list->items[index].complete) {
+            fprintf(state_fp, "%s\n", uid);
+            fflush(state_fp);
+            uidls[i].synced = 1;
+        }
+
+        printf("[Email #%d] Date: %s From: %s Subject: %s has_signature: %s\n", 
+               index + 1, list->items[index].date, list->items[index].from, 
+               list->items[index].subject, signature_mark(list->items[index].has_signature));
     }
 
-    // 提供用户选择邮件查看
-    printf("\n请给出你想阅读的邮件序号(1-%zu, 输入0则退出)：", list->count);
-    int mail_num;
-    scanf("%d", &mail_num);
+    printf("本次同步: 建立连接%d次, 登录%d次, 新邮件%d封, 跳过已同步%d封, 接收%zu字节\n",
+           session.connect_count, session.login_count, list->count,
+           list->skipped_count, session.bytes_received);
+
+    int mail_num = 0;
+    if (list->count == 0) {
+        printf("没有新邮件\n");
+    } else {
+        // 提供用户选择邮件查看
+        printf("\n请给出你想阅读的邮件序号(1-%d, 输入0则退出)：", list->count);
+        scanf("%d", &mail_num);
+    }
 
-    if (mail_num == 0) {
-        return list;
-    } else if (mail_num >= 1 && mail_num <= list->count) {
-        // 显示所选邮件的详细信息
-        printf("Email #%u: Date: %s From: %s Subject: %s\n", 
-               mail_num, 
-               list->items[mail_num - 1].date, 
-               list->items[mail_num - 1].from, 
-               list->items[mail_num - 1].subject);
-        if (list->items[mail_num - 1].has_signature) {
-        printf("Content: %s\n", list->items[mail_num - 1].body);
-       
-        if (list->items[mail_num - 1].has_signature) {
-            printf("Signature: %s\n", list->items[mail_num - 1].signature_file);
-            
-            // Base64解码签名并进行验证
-            size_t decoded_len = 0;
-            long sig_size = strlen(list->items[mail_num - 1].signature_file);
-            unsigned char* decoded_signature = malloc(sig_size * 2);  // 预留足够的空间
-
-            // 调用 base64_decode 函数解码签名
-            int ret = base64_decode(list->items[mail_num - 1].signature_file, 
-                                    strlen(list->items[mail_num - 1].signature_file), 
-                                    decoded_signature, &decoded_len);
-
-            if (ret != 1) {
-                printf("签名Base64解码失败！错误代码：%d\n", ret);
-            } 
-            else {
-                // 打印解码后的签名（调试用）
-                printf("Decoded signature: ");
-                for (size_t i = 0; i < decoded_len; ++i) {
-                    printf("%02x", decoded_signature[i]);  // 以十六进制输出解码后的签名
-                }
-                printf("\n");
-
-                    if (!verify_signature(list->items[mail_num - 1].body, 
-                                        decoded_signature, 
-                                        decoded_len, 
-                                        "public.pem")) {
-                        printf("签名验证失败！消息可能被篡改。\n");
-                    }
-                    else {
-                        printf("验签成功！消息真实\n");
-                    }
-                }
-                free(decoded_signature);  // 释放解码后的签名内存
+    // 仅邮件头模式下，只有被选中的邮件才在同一会话上完整下载；下载失败时不显示预览，
+    // 截断的正文和未知的签名状态会被误判为验签失败
+    int show = mail_num >= 1 && mail_num <= list->count;
+    if (show && !list->items[mail_num - 1].complete) {
+        mail_item_t* item = &list->items[mail_num - 1];
+        res = fetch_mail_item(&session, list, mail_num - 1, item->msg_num, item->uid, MAIL_LIST_FULL, store);
+        if (res != CURLE_OK) {
+            printf("Failed to retrieve email %d: %s\n", mail_num, curl_easy_strerror(res));
+            show = 0;
+        } else if (state_fp) {
+            // 选中的邮件已完整下载，记为已同步
+            fprintf(state_fp, "%s\n", item->uid);
+            for (int i = 0; i < mail_count; i++) {
+                if (uidls[i].msg_num == item->msg_num) uidls[i].synced = 1;
             }
         }
-        else {
-            printf("没有签名,不进行验签\n");
+    }
+
+    if (state_fp) {
+        fclose(state_fp);
+        // 状态文件里有服务器上已不存在的UID时才重写
+        if (known_count > (size_t)list->skipped_count) {
+            save_uidl_state(UIDL_STATE_FILE, uidls, mail_count);
         }
     }
+    hashmap_free(known, NULL);
+    free(uidls);
+
+    pop3_session_close(&session);
+    mail_store_close(store);
+    list->connect_count = session.connect_count;
+    list->login_count = session.login_count;
+    list->bytes_received = session.bytes_received;
+
+    if (show) {
+        show_mail_item(&list->items[mail_num - 1], mail_num);
+    }
     return list;
 }
 
+// 联网按UID补全本地只存了邮件头的邮件，解析到list第0项并写回本地邮件库
+static int fetch_stored_mail(const mail_config_t* config, const char* uid, mail_list_t* list) {
+    pop3_session_t session;
+    if (!pop3_session_open(&session, config)) return 0;
+
+    // 邮件序号会随服务器上的删除而变化，需要先用UIDL找到它
+    receive_ctx_t ctx = { NULL, 0 };
+    uidl_entry_t* uidls = NULL;
+    int count = 0;
+    if (pop3_session_request(&session, "", "UIDL", &ctx) == CURLE_OK && ctx.data) {
+        count = parse_uidl(ctx.data, &uidls);
+    }
+    free(ctx.data);
+
+    int ok = 0;
+    for (int i = 0; i < count; i++) {
+        if (strcmp(uidls[i].uid, uid) != 0) continue;
+
+        mail_store_t* store = mail_store_open(MAIL_STORE_FILE, MAIL_INDEX_FILE);
+        ok = fetch_mail_item(&session, list, 0, uidls[i].msg_num, uid, MAIL_LIST_FULL, store) == CURLE_OK;
+        mail_store_close(store);
+
+        // 已完整下载，之后的-l不再列出
+        FILE* state_fp = ok ? fopen(UIDL_STATE_FILE, "a") : NULL;
+        if (state_fp) {
+            fprintf(state_fp, "%s\n", uid);
+            fclose(state_fp);
+        }
+        break;
+    }
+
+    free(uidls);
+    pop3_session_close(&session);
+    return ok;
+}
+
+int list_local_mail(const mail_config_t* config) {
+    mail_index_view_t view;
+    if (!mail_index_map(&view, MAIL_STORE_FILE, MAIL_INDEX_FILE)) {
+        printf("本地邮件库为空，请先运行 -l 同步邮件\n");
+        return 0;
+    }
+
+    // 直接读映射的定长索引记录，不解析邮件也不访问网络
+    for (size_t i = 0; i < view.count; i++) {
+        const mail_record_t* record = &view.records[i];
+        printf("[Email #%zu] Date: %.*s From: %.*s Subject: %.*s has_signature: %s\n",
+               i + 1,
+               (int)sizeof(record->date), record->date,
+               (int)sizeof(record->from), record->from,
+               (int)sizeof(record->subject), record->subject,
+               signature_mark(record_signature(record->flags)));
+    }
+    printf("本地共%zu封邮件\n", view.count);
+
+    printf("\n请给出你想阅读的邮件序号(1-%zu, 输入0则退出)：", view.count);
+    int mail_num = 0;
+    scanf("%d", &mail_num);
+    if (mail_num < 1 || (size_t)mail_num > view.count) {
+        mail_index_unmap(&view);
+        return 1;
+    }
+
+    const mail_record_t* record = &view.records[mail_num - 1];
+    mail_list_t* list = NULL;
+    int ok = 0;
+
+    if (record->flags & MAIL_RECORD_COMPLETE) {
+        // 完整邮件直接在映射区上解析显示，不复制邮件内容
+        size_t raw_len = 0;
+        const char* raw = mail_index_raw(&view, mail_num - 1, &raw_len);
+        if (raw) {
+            mail_view_t mail;
+            mail_view_parse(&mail, raw, raw_len);
+            show_mail_view(&mail, mail_num);
+            ok = 1;
+        }
+    } else if (config && (list = new_mail_list())) {
+        printf("本地只保存了邮件头，正在从服务器下载完整邮件...\n");
+        if ((ok = fetch_stored_mail(config, record->uid, list))) {
+            show_mail_item(&list->items[0], mail_num);
+        }
+    }
+
+    if (!ok) {
+        printf("无法读取邮件 #%d\n", mail_num);
+    }
+
+    free_mail_list(list);
+    mail_index_unmap(&view);
+    return ok;
+}
+
+int audit_local_mail(int threads) {
+    mail_index_view_t view;
+    if (!mail_index_map(&view, MAIL_STORE_FILE, MAIL_INDEX_FILE)) {
+        printf("本地邮件库为空，请先运行 -l 同步邮件\n");
+        return 0;
+    }
+
+    mail_list_t* list = new_mail_list();
+    if (!list || !(list->items = calloc(view.count, sizeof(mail_item_t)))) {
+        free_mail_list(list);
+        mail_index_unmap(&view);
+        return 0;
+    }
+
+    // 完整邮件直接在映射区上解析，只有邮件头的记录按索引标志计入统计
+    for (size_t i = 0; i < view.count; i++) {
+        const mail_record_t* record = &view.records[i];
+        mail_item_t* item = &list->items[list->count++];
+        item->msg_num = i + 1;
+        item->has_signature = record_signature(record->flags);
+
+        size_t raw_len = 0;
+        const char* raw = (record->flags & MAIL_RECORD_COMPLETE) ? mail_index_raw(&view, i, &raw_len) : NULL;
+        if (raw) {
+            mail_view_t mail;
+            mail_view_parse(&mail, raw, raw_len);
+            mail_view_materialize(&mail, list->arena, item);
+            item->complete = 1;
+        }
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    mail_verify_stats_t stats;
+    key_directory_t* keys = key_directory_default();
+    int ok = keys && verify_mail_list(list, keys, VERIFY_CACHE_FILE, threads, &stats);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    if (!ok) {
+        printf("内存不足，无法验签\n");
+    } else {
+        for (int i = 0; i < list->count; i++) {
+            int status = list->items[i].verify_status;
+            const char* reason = status == MAIL_SIG_FAILED ? "签名验证失败"
+                               : status == MAIL_SIG_INVALID ? "无法验签"
+                               : status == MAIL_SIG_NO_KEY ? "找不到发件人公钥" : NULL;
+            if (!reason) continue;
+
+            const mail_record_t* record = &view.records[i];
+            printf("[Email #%d] From: %.*s Subject: %.*s %s\n", i + 1,
+                   (int)sizeof(record->from), record->from,
+                   (int)sizeof(record->subject), record->subject, reason);
+        }
+
+        double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+        printf("共%d封: 验签通过%zu, 验签失败%zu, 无法验签%zu, 找不到公钥%zu, 无签名%zu, 只有邮件头未验签%zu\n",
+               list->count, stats.verified, stats.failed, stats.invalid, stats.no_key,
+               stats.unsigned_count, stats.unchecked);
+        printf("验签用时%.3f秒(%d线程, 缓存命中%zu封)\n", seconds,
+               threads > 0 ? threads : thread_pool_default_threads(), stats.cached);
+    }
+
+    free_mail_list(list);
+    mail_index_unmap(&view);
+    return ok && stats.failed == 0 && stats.invalid == 0;
+}
+
 mail_content_t* receive_mail_content(const mail_config_t* config, const char* uid) {
     CURL* curl = curl_easy_init();
     if (!curl) return NULL;
@@ -374,12 +853,8 @@ mail_content_t* receive_mail_content(const mail_config_t* config, const char* ui
 void free_mail_list(mail_list_t* list) {
     if (!list) return;
 
-    for (int i = 0; i < list->count; i++) {
-        free(list->items[i].uid);
-        free(list->items[i].from);
-        free(list->items[i].subject);
-        free(list->items[i].date);
-    }
+    // 邮件项里的字符串都在内存池中，一次释放
+    arena_free(list->arena);
     free(list->items);
     free(list);
 }
@@ -396,11 +871,10 @@ void free_mail_content(mail_content_t* content) {
     free(content);
 }
 
-// 解析特定邮件
+// 解析特定邮件(mail_index为服务器上的邮件序号)
 int parse_mail(const mail_config_t* config, int mail_index) {
-    // 假设邮件列表已经获取
-    mail_list_t* list = receive_mail_list(config);
-    if (!list || mail_index < 1 || mail_index > list->count) {
+    // 增量同步后列表里只有新邮件，序号是否有效交给服务器判断
+    if (mail_index < 1) {
         printf("无效的邮件编号！\n");
         return 0;
     }
@@ -429,7 +903,6 @@ int parse_mail(const mail_config_t* config, int mail_index) {
         printf("curl_easy_perform() failed: %s\n", curl_easy_strerror(res));
         curl_easy_cleanup(curl);
         free(ctx.data);
-        free_mail_list(list);
         return 0;
     } else {
         // 解析邮件内容
@@ -440,6 +913,5 @@ int parse_mail(const mail_config_t* config, int mail_index) {
 
     curl_easy_cleanup(curl);
     free(ctx.data);
-    free_mail_list(list);
     return 1;
 } 
\ No newline at end of file
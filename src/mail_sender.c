@@ -0,0 +1,596 @@
+#include "mail_sender.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <time.h>
+
+#define POLL_TIMEOUT_MS 1000
+
+// 旧版头文件中这个选项的拼写(7.69起)
+#ifndef CURLOPT_MAIL_RCPT_ALLOWFAILS
+#define CURLOPT_MAIL_RCPT_ALLOWFAILS CURLOPT_MAIL_RCPT_ALLLOWFAILS
+#endif
+
+// 收件人的投递状态
+#define RCPT_PENDING  0  // 还没有结果
+#define RCPT_SENT     1
+#define RCPT_REJECTED 2  // 服务器永久拒绝(5xx)
+#define RCPT_DEFERRED 3  // 暂时失败(4xx)，留给调用者稍后重试
+
+struct mail_sender_job {
+    mime_builder_t* mime;
+    char** recipients;        // 全部收件人地址
+    unsigned char* status;    // 各收件人的RCPT_*
+    size_t recipient_count;
+    size_t recipient_cap;
+    size_t* chunk;            // 当前事务的收件人在recipients中的下标
+    int* codes;               // 当前事务各收件人的RCPT回复码，0为没有读到
+    size_t chunk_count;       // 当前事务的收件人数
+    size_t rcpt_sent;         // libcurl在当前事务中已发出的RCPT数
+    size_t rcpt_replies;      // 已读到的RCPT回复数
+    struct curl_slist* rcpt;  // 当前事务的RCPT列表
+    char* from;
+    void* user;
+    int retried;
+    double started;           // 第一个事务开始的时间
+    mail_sender_job_t* next;
+};
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// libcurl回调函数，直接从邮件片段中读取要发送的数据。
+// 附件读取失败或内容与签名不符时中止传输，不能让libcurl把截断处当成邮件结尾
+static size_t payload_source(void* ptr, size_t size, size_t nmemb, void* userp) {
+    mime_builder_t* mime = (mime_builder_t*)userp;
+    size_t n = mime_builder_read(mime, ptr, size * nmemb);
+    return mime->error ? CURL_READFUNC_ABORT : n;
+}
+
+// libcurl不单独报告每个RCPT的结果，从协议跟踪中取出：RCPT命令逐条发出并等待回复，
+// 发出之后读到的第一条完整回复就是它的回复
+static int trace_rcpt(CURL* curl, curl_infotype type, char* data, size_t size, void* userp) {
+    (void)curl;
+    mail_sender_job_t* job = ((mail_sender_conn_t*)userp)->job;
+    if (!job) return 0;
+
+    if (type == CURLINFO_HEADER_OUT) {
+        if (size >= 8 && strncasecmp(data, "RCPT TO:", 8) == 0) job->rcpt_sent++;
+    } else if (type == CURLINFO_HEADER_IN && job->rcpt_replies < job->rcpt_sent
+               && job->rcpt_replies < job->chunk_count && size >= 4
+               && isdigit((unsigned char)data[0]) && isdigit((unsigned char)data[1])
+               && isdigit((unsigned char)data[2]) && data[3] != '-') {
+        job->codes[job->rcpt_replies++] = (data[0] - '0') * 100 + (data[1] - '0') * 10 + (data[2] - '0');
+    }
+    return 0;
+}
+
+// 连接层面的失败：服务器关闭了连接或用421拒绝继续，换新连接可以恢复。
+// 其他4xx/5xx回复(如收件人被拒)是命令本身失败，重发也一样
+static int connection_lost(CURLcode res, long response) {
+    return (res == CURLE_SEND_ERROR || res == CURLE_RECV_ERROR || res == CURLE_GOT_NOTHING)
+        && (response == 421 || response < 400);
+}
+
+static void free_job(mail_sender_job_t* job) {
+    mime_builder_free(job->mime);
+    for (size_t i = 0; i < job->recipient_count; i++) free(job->recipients[i]);
+    free(job->recipients);
+    free(job->status);
+    free(job->chunk);
+    free(job->codes);
+    curl_slist_free_all(job->rcpt);
+    free(job->from);
+    free(job);
+}
+
+// 追加逗号或分号分隔的地址列表，"名字 <地址>"只取尖括号内的部分。
+// 引号中的显示名、括号中的注释和尖括号内的逗号、分号不是分隔符
+static int add_recipients(mail_sender_job_t* job, const char* list) {
+    while (list && *list) {
+        const char* open = NULL;
+        const char* close = NULL;
+        const char* p = list;
+        int quoted = 0, comment = 0;
+        for (; *p; p++) {
+            if (quoted || comment) {
+                if (*p == '\\' && p[1]) p++;
+                else if (quoted && *p == '"') quoted = 0;
+                else if (comment && *p == '(') comment++;
+                else if (comment && *p == ')') comment--;
+            } else if (*p == '"') {
+                quoted = 1;
+            } else if (*p == '(') {
+                comment = 1;
+            } else if (*p == '<' && !open) {
+                open = p;
+            } else if (*p == '>' && open && !close) {
+                close = p;
+            } else if ((*p == ',' || *p == ';') && (!open || close)) {
+                break;
+            }
+        }
+
+        const char* start = list;
+        const char* end = p;
+        if (close) {
+            start = open + 1;
+            end = close;
+        }
+        while (start < end && isspace((unsigned char)*start)) start++;
+        while (end > start && isspace((unsigned char)end[-1])) end--;
+
+        if (end > start) {
+            if (job->recipient_count == job->recipient_cap) {
+                size_t cap = job->recipient_cap ? job->recipient_cap * 2 : 8;
+                char** recipients = realloc(job->recipients, cap * sizeof(char*));
+                if (!recipients) return 0;
+                job->recipients = recipients;
+                job->recipient_cap = cap;
+            }
+            char* address = strndup(start, end - start);
+            if (!address) return 0;
+            job->recipients[job->recipient_count++] = address;
+        }
+        list = *p ? p + 1 : p;
+    }
+    return 1;
+}
+
+mail_sender_t* mail_sender_new(const mail_config_t* config, int connections,
+                               mail_sender_done_fn done, void* done_arg) {
+    if (connections < 1) connections = 1;
+    if (connections > MAIL_SENDER_MAX_CONNECTIONS) connections = MAIL_SENDER_MAX_CONNECTIONS;
+
+    mail_sender_t* sender = calloc(1, sizeof(mail_sender_t));
+    if (!sender) return NULL;
+    sender->done = done;
+    sender->done_arg = done_arg;
+    sender->rcpt_limit = MAIL_RCPT_CHUNK;
+    sender->config = *config;
+    sender->extensions_mask = ~0;
+    pthread_mutex_init(&sender->lock, NULL);
+    snprintf(sender->url, sizeof(sender->url), "%s://%s:%d",
+        config->use_ssl ? "smtps" : "smtp",
+        config->smtp_server,
+        config->port);
+
+    sender->conns = calloc(connections, sizeof(mail_sender_conn_t));
+    if (!sender->conns) {
+        mail_sender_free(sender);
+        return NULL;
+    }
+    // 内置引擎的会话在发送时才连接
+    if (config->smtp_native) {
+        sender->conn_count = connections;
+        return sender;
+    }
+
+    sender->multi = curl_multi_init();
+    if (!sender->multi) {
+        mail_sender_free(sender);
+        return NULL;
+    }
+    // 连接池大小等于会话数，空闲连接留给下一封邮件复用
+    curl_multi_setopt(sender->multi, CURLMOPT_MAX_HOST_CONNECTIONS, (long)connections);
+    curl_multi_setopt(sender->multi, CURLMOPT_MAXCONNECTS, (long)connections);
+
+    for (int i = 0; i < connections; i++) {
+        CURL* curl = curl_easy_init();
+        if (!curl) {
+            mail_sender_free(sender);
+            return NULL;
+        }
+        sender->conns[i].curl = curl;
+        sender->conn_count++;
+
+        // 连接相关的选项只设置一次
+        curl_easy_setopt(curl, CURLOPT_URL, sender->url);
+        curl_easy_setopt(curl, CURLOPT_USERNAME, config->username);
+        curl_easy_setopt(curl, CURLOPT_PASSWORD, config->password);
+        curl_easy_setopt(curl, CURLOPT_USE_SSL, config->use_ssl ? CURLUSESSL_ALL : CURLUSESSL_NONE);
+        curl_easy_setopt(curl, CURLOPT_READFUNCTION, payload_source);
+        curl_easy_setopt(curl, CURLOPT_UPLOAD, 1L);
+        curl_easy_setopt(curl, CURLOPT_TCP_NODELAY, 1L);
+        curl_easy_setopt(curl, CURLOPT_PRIVATE, &sender->conns[i]);
+        // 部分收件人被拒绝时照常发给其余收件人，各自的结果由trace_rcpt记下
+        curl_easy_setopt(curl, CURLOPT_MAIL_RCPT_ALLOWFAILS, 1L);
+        curl_easy_setopt(curl, CURLOPT_DEBUGFUNCTION, trace_rcpt);
+        curl_easy_setopt(curl, CURLOPT_DEBUGDATA, &sender->conns[i]);
+        curl_easy_setopt(curl, CURLOPT_VERBOSE, 1L);
+    }
+    return sender;
+}
+
+int mail_sender_queue(mail_sender_t* sender, const mail_content_t* content, void* user) {
+    mail_sender_job_t* job = calloc(1, sizeof(mail_sender_job_t));
+    if (!job) return 0;
+
+    job->mime = generate_mime_message(content);
+    job->from = strdup(content->from);
+    job->user = user;
+    int ok = job->mime && job->from;
+    if (ok && content->envelope) {
+        ok = add_recipients(job, content->envelope);
+    } else if (ok) {
+        ok = add_recipients(job, content->to)
+          && add_recipients(job, content->cc)
+          && add_recipients(job, content->bcc);
+    }
+    if (ok && job->recipient_count) {
+        job->status = calloc(job->recipient_count, 1);
+        job->chunk = malloc(job->recipient_count * sizeof(size_t));
+        job->codes = malloc(job->recipient_count * sizeof(int));
+    }
+    if (!ok || !job->status || !job->chunk || !job->codes) {
+        free_job(job);
+        return 0;
+    }
+
+    if (sender->tail) sender->tail->next = job;
+    else sender->head = job;
+    sender->tail = job;
+    sender->queued++;
+    return 1;
+}
+
+// 选出下一批还没有结果的收件人，最多limit个
+static size_t pick_chunk(mail_sender_job_t* job, size_t limit) {
+    job->chunk_count = 0;
+    for (size_t i = 0; i < job->recipient_count && job->chunk_count < limit; i++) {
+        if (job->status[i] == RCPT_PENDING) {
+            job->codes[job->chunk_count] = 0;
+            job->chunk[job->chunk_count++] = i;
+        }
+    }
+    return job->chunk_count;
+}
+
+static int has_pending(const mail_sender_job_t* job) {
+    for (size_t i = 0; i < job->recipient_count; i++) {
+        if (job->status[i] == RCPT_PENDING) return 1;
+    }
+    return 0;
+}
+
+static void lower_rcpt_limit(mail_sender_t* sender, size_t limit) {
+    pthread_mutex_lock(&sender->lock);
+    if (limit > 0 && sender->rcpt_limit > limit) sender->rcpt_limit = limit;
+    pthread_mutex_unlock(&sender->lock);
+}
+
+// 一个事务结束，记下各收件人的结果：事务提交时RCPT通过的收件人投递成功，
+// 回复452(收件人过多)的留到下一个事务，其他4xx/5xx分别记为暂时失败和被拒绝。
+// 返回1表示还有收件人要在下一个事务中发送，0表示已全部有结果，
+// 或事务本身失败(MAIL FROM、正文被拒绝或没有读到RCPT回复)不能继续
+static int advance_job(mail_sender_t* sender, mail_sender_conn_t* conn,
+                       mail_sender_job_t* job, int committed) {
+    size_t accepted = 0, deferred = 0, replied = 0;
+    for (size_t i = 0; i < job->chunk_count; i++) {
+        size_t r = job->chunk[i];
+        int code = job->codes[i];
+        // libcurl没有报告RCPT回复时，事务提交就说明这些收件人都已通过
+        if (code / 100 == 2 || (code == 0 && committed)) {
+            accepted++;
+            if (committed) job->status[r] = RCPT_SENT;
+        } else if (code == 452) {
+            deferred++;
+        } else if (code >= 400) {
+            fprintf(stderr, "收件人%s被拒绝: %d\n", job->recipients[r], code);
+            job->status[r] = code >= 500 ? RCPT_REJECTED : RCPT_DEFERRED;
+        }
+        if (code) replied++;
+    }
+
+    if (committed) {
+        conn->stats.transactions++;
+        conn->stats.recipients += accepted;
+        // 服务器接受的数量就是它单个事务的上限
+        if (deferred) lower_rcpt_limit(sender, accepted);
+    } else if (accepted || replied < job->chunk_count) {
+        return 0;
+    } else if (deferred == job->chunk_count) {
+        // 整批都超过了服务器的上限，减半重发；只剩一个收件人还被暂缓就留给调用者稍后重试
+        if (job->chunk_count > 1) lower_rcpt_limit(sender, job->chunk_count / 2);
+        else job->status[job->chunk[0]] = RCPT_DEFERRED;
+    }
+    return has_pending(job);
+}
+
+// 一封邮件结束：汇总各收件人的结果，记账并回调
+static void job_done(mail_sender_t* sender, mail_sender_conn_t* conn, mail_sender_job_t* job, double seconds) {
+    mail_sender_result_t result = { 1, 0, 0, NULL, seconds };
+    size_t len = 1;
+    for (size_t i = 0; i < job->recipient_count; i++) {
+        if (job->status[i] == RCPT_SENT) {
+            result.delivered++;
+            continue;
+        }
+        result.ok = 0;
+        if (job->status[i] == RCPT_REJECTED) result.rejected++;
+        else len += strlen(job->recipients[i]) + 1;
+    }
+
+    // 还没有结果和暂时失败的收件人可以重试
+    char* retry = result.ok ? NULL : malloc(len);
+    if (retry) {
+        char* p = retry;
+        for (size_t i = 0; i < job->recipient_count; i++) {
+            if (job->status[i] == RCPT_SENT || job->status[i] == RCPT_REJECTED) continue;
+            if (p > retry) *p++ = ',';
+            size_t n = strlen(job->recipients[i]);
+            memcpy(p, job->recipients[i], n);
+            p += n;
+        }
+        *p = '\0';
+    }
+    result.retry = retry;
+
+    if (result.ok) conn->stats.sent++;
+    else conn->stats.failed++;
+    if (sender->done) sender->done(job->user, &result, sender->done_arg);
+    free(retry);
+}
+
+// 把一封邮件的下一批收件人交给发送通道，开始一个SMTP事务
+static int start_job(mail_sender_t* sender, mail_sender_conn_t* conn, mail_sender_job_t* job) {
+    conn->started = now_seconds();
+    if (!job->started) job->started = conn->started;
+
+    curl_slist_free_all(job->rcpt);
+    job->rcpt = NULL;
+    job->rcpt_sent = job->rcpt_replies = 0;
+    pick_chunk(job, sender->rcpt_limit);
+    for (size_t i = 0; i < job->chunk_count; i++) {
+        struct curl_slist* rcpt = curl_slist_append(job->rcpt, job->recipients[job->chunk[i]]);
+        if (!rcpt) return 0;
+        job->rcpt = rcpt;
+    }
+
+    CURL* curl = conn->curl;
+    curl_easy_setopt(curl, CURLOPT_MAIL_FROM, job->from);
+    curl_easy_setopt(curl, CURLOPT_MAIL_RCPT, job->rcpt);
+    curl_easy_setopt(curl, CURLOPT_READDATA, job->mime);
+    curl_easy_setopt(curl, CURLOPT_FRESH_CONNECT, job->retried ? 1L : 0L);
+    if (curl_multi_add_handle(sender->multi, curl) != CURLM_OK) return 0;
+    conn->job = job;
+    return 1;
+}
+
+// 从队列头取下一封邮件
+static mail_sender_job_t* next_job(mail_sender_t* sender) {
+    mail_sender_job_t* job = sender->head;
+    if (job) {
+        sender->head = job->next;
+        if (!sender->head) sender->tail = NULL;
+        job->next = NULL;
+        sender->queued--;
+    }
+    return job;
+}
+
+// 一个事务结束：连接被断开时重发一次，记下各收件人的结果，
+// 还有收件人时在同一通道上开始下一个事务，否则记账、回调并释放
+static void finish_job(mail_sender_t* sender, mail_sender_conn_t* conn, CURLcode res) {
+    CURL* curl = conn->curl;
+    mail_sender_job_t* job = conn->job;
+    double now = now_seconds();
+
+    long connects = 0, response = 0;
+    curl_off_t bytes = 0;
+    curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &connects);
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response);
+    curl_easy_getinfo(curl, CURLINFO_SIZE_UPLOAD_T, &bytes);
+    curl_multi_remove_handle(sender->multi, curl);
+
+    conn->stats.connects += connects;
+    conn->stats.busy += now - conn->started;
+    conn->job = NULL;
+
+    if (res != CURLE_OK && connects == 0 && connection_lost(res, response) && !job->retried) {
+        // 复用的连接已被服务器关闭，新建连接重发
+        job->retried = 1;
+        mime_builder_rewind(job->mime);
+        if (start_job(sender, conn, job)) return;
+    }
+
+    if (res == CURLE_OK) conn->stats.bytes += bytes;
+    if (advance_job(sender, conn, job, res == CURLE_OK)) {
+        // 同一份MIME重新读一遍，发给下一批收件人
+        job->retried = 0;
+        mime_builder_rewind(job->mime);
+        if (start_job(sender, conn, job)) return;
+    } else if (res != CURLE_OK) {
+        fprintf(stderr, "curl_easy_perform() failed: %s\n", curl_easy_strerror(res));
+    }
+
+    job_done(sender, conn, job, now - job->started);
+    free_job(job);
+}
+
+// 内置引擎发送一封邮件：收件人按rcpt_limit分批，各收件人的结果由advance_job记下。
+// 复用的会话断开时新建会话重发一次
+static void deliver_native(mail_sender_t* sender, mail_sender_conn_t* conn, mail_sender_job_t* job) {
+    char** addresses = malloc(job->recipient_count * sizeof(char*));
+    if (!addresses) return;
+
+    job->started = now_seconds();
+    int more = 1;
+    while (more) {
+        int reused = conn->smtp != NULL;
+        if (!conn->smtp) {
+            conn->smtp = smtp_client_connect(&sender->config, sender->extensions_mask);
+            if (!conn->smtp) {
+                fprintf(stderr, "无法连接SMTP服务器%s:%d\n", sender->config.smtp_server, sender->config.port);
+                break;
+            }
+            conn->stats.connects++;
+        }
+
+        pthread_mutex_lock(&sender->lock);
+        size_t limit = sender->rcpt_limit;
+        pthread_mutex_unlock(&sender->lock);
+        size_t chunk = pick_chunk(job, limit);
+        for (size_t i = 0; i < chunk; i++) addresses[i] = job->recipients[job->chunk[i]];
+
+        double started = now_seconds();
+        mime_builder_rewind(job->mime);
+        int res = smtp_client_send(conn->smtp, job->from, addresses, chunk, job->mime, job->codes);
+        conn->stats.busy += now_seconds() - started;
+
+        if (res < 0) {
+            smtp_client_close(conn->smtp);
+            conn->smtp = NULL;
+            if (job->mime->error) {
+                fprintf(stderr, "附件读取失败或与签名不符，放弃发送\n");
+                break;
+            }
+            if (reused && !job->retried) {
+                job->retried = 1;
+                continue;
+            }
+            fprintf(stderr, "SMTP连接中断\n");
+            break;
+        }
+
+        if (res > 0) conn->stats.bytes += job->mime->size;
+        more = advance_job(sender, conn, job, res > 0);
+        if (!more && res == 0 && has_pending(job)) fprintf(stderr, "SMTP发送失败: %s\n", conn->smtp->reply);
+        job->retried = 0;
+    }
+
+    free(addresses);
+}
+
+typedef struct {
+    mail_sender_t* sender;
+    mail_sender_conn_t* conn;
+} native_worker_t;
+
+// 内置引擎的发送线程：一个会话，从共享队列领取邮件直到队列为空
+static void* native_worker(void* arg) {
+    native_worker_t* worker = (native_worker_t*)arg;
+    mail_sender_t* sender = worker->sender;
+    mail_sender_conn_t* conn = worker->conn;
+
+    for (;;) {
+        pthread_mutex_lock(&sender->lock);
+        mail_sender_job_t* job = next_job(sender);
+        pthread_mutex_unlock(&sender->lock);
+        if (!job) break;
+
+        deliver_native(sender, conn, job);
+        double seconds = now_seconds() - job->started;
+        pthread_mutex_lock(&sender->lock);
+        job_done(sender, conn, job, seconds);
+        pthread_mutex_unlock(&sender->lock);
+        free_job(job);
+    }
+    return NULL;
+}
+
+static void run_native(mail_sender_t* sender) {
+    native_worker_t* workers = calloc(sender->conn_count, sizeof(native_worker_t));
+    pthread_t* threads = calloc(sender->conn_count, sizeof(pthread_t));
+    int* started = calloc(sender->conn_count, sizeof(int));
+    if (!workers || !threads || !started) {
+        free(workers);
+        free(threads);
+        free(started);
+        return;
+    }
+
+    // 第一个会话在调用线程上运行，线程创建失败的会话也由调用线程补上
+    for (int i = 0; i < sender->conn_count; i++) {
+        workers[i].sender = sender;
+        workers[i].conn = &sender->conns[i];
+        started[i] = i > 0 && pthread_create(&threads[i], NULL, native_worker, &workers[i]) == 0;
+    }
+    for (int i = 0; i < sender->conn_count; i++) {
+        if (!started[i]) native_worker(&workers[i]);
+    }
+    for (int i = 0; i < sender->conn_count; i++) {
+        if (started[i]) pthread_join(threads[i], NULL);
+    }
+
+    free(workers);
+    free(threads);
+    free(started);
+}
+
+int mail_sender_run(mail_sender_t* sender) {
+    double start = now_seconds();
+    size_t failed_before = 0;
+    for (int i = 0; i < sender->conn_count; i++) failed_before += sender->conns[i].stats.failed;
+
+    int running = 0;
+    if (!sender->multi) run_native(sender);
+    while (sender->multi) {
+        // 空闲的通道领取下一封邮件
+        for (int i = 0; i < sender->conn_count && sender->head; i++) {
+            mail_sender_conn_t* conn = &sender->conns[i];
+            if (conn->job) continue;
+
+            mail_sender_job_t* job = next_job(sender);
+            if (!start_job(sender, conn, job)) {
+                job_done(sender, conn, job, 0);
+                free_job(job);
+            }
+        }
+
+        if (curl_multi_perform(sender->multi, &running) != CURLM_OK) break;
+
+        CURLMsg* msg;
+        int pending;
+        while ((msg = curl_multi_info_read(sender->multi, &pending))) {
+            if (msg->msg != CURLMSG_DONE) continue;
+            mail_sender_conn_t* conn = NULL;
+            curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char**)&conn);
+            finish_job(sender, conn, msg->data.result);
+        }
+
+        int busy = 0;
+        for (int i = 0; i < sender->conn_count; i++) busy |= sender->conns[i].job != NULL;
+        if (!busy && !sender->head) break;
+        if (running) curl_multi_poll(sender->multi, NULL, 0, POLL_TIMEOUT_MS, NULL);
+    }
+
+    // 汇总各通道的计数
+    memset(&sender->total, 0, sizeof(sender->total));
+    for (int i = 0; i < sender->conn_count; i++) {
+        const mail_sender_stats_t* stats = &sender->conns[i].stats;
+        sender->total.sent += stats->sent;
+        sender->total.failed += stats->failed;
+        sender->total.connects += stats->connects;
+        sender->total.transactions += stats->transactions;
+        sender->total.recipients += stats->recipients;
+        sender->total.bytes += stats->bytes;
+        sender->total.busy += stats->busy;
+    }
+    sender->elapsed += now_seconds() - start;
+    return sender->total.failed == failed_before && !sender->head;
+}
+
+void mail_sender_free(mail_sender_t* sender) {
+    if (!sender) return;
+
+    for (int i = 0; i < sender->conn_count; i++) {
+        mail_sender_conn_t* conn = &sender->conns[i];
+        if (conn->job) {
+            curl_multi_remove_handle(sender->multi, conn->curl);
+            free_job(conn->job);
+        }
+        if (conn->curl) curl_easy_cleanup(conn->curl);
+        smtp_client_close(conn->smtp);
+    }
+    while (sender->head) free_job(next_job(sender));
+    if (sender->multi) curl_multi_cleanup(sender->multi);
+    pthread_mutex_destroy(&sender->lock);
+    free(sender->conns);
+    free(sender);
+}
@@ -0,0 +1,88 @@
+#ifndef MAIL_SENDER_H
+#define MAIL_SENDER_H
+
+#include <stddef.h>
+#include <pthread.h>
+#include <curl/curl.h>
+#include "mail.h"
+#include "mime_builder.h"
+#include "smtp_client.h"
+
+#define MAIL_SENDER_MAX_CONNECTIONS 64
+// 单个SMTP事务的收件人数上限，RFC 5321要求服务器至少接受100个；
+// 服务器回复452(收件人过多)时自动减半
+#define MAIL_RCPT_CHUNK 100
+
+// 发送计数：每个连接一份，另有全部连接的汇总
+typedef struct {
+    size_t sent;      // 发送成功的邮件数
+    size_t failed;
+    size_t connects;  // 实际建立的连接数(含被服务器断开后的重连)
+    size_t transactions;  // SMTP事务数，收件人多的邮件按MAIL_RCPT_CHUNK拆成多个事务
+    size_t recipients;    // 投递成功的收件人数
+    size_t bytes;     // 上传的邮件字节数
+    double busy;      // 处于发送中的累计秒数
+} mail_sender_stats_t;
+
+// 一封邮件的投递结果
+typedef struct {
+    int ok;             // 全部收件人都投递成功
+    size_t delivered;   // 投递成功的收件人数
+    size_t rejected;    // 被服务器永久拒绝(5xx)的收件人数
+    const char* retry;  // 其余可以稍后重试的收件人，逗号分隔，可能为空串；成功或内存不足时为NULL
+    double seconds;     // 从开始传输到完成的时间
+} mail_sender_result_t;
+
+// 每封邮件发送结束时回调，result在回调返回后失效
+typedef void (*mail_sender_done_fn)(void* user, const mail_sender_result_t* result, void* arg);
+
+// 一封排队的邮件
+typedef struct mail_sender_job mail_sender_job_t;
+
+// 发送通道：一个curl easy句柄(连接在句柄之间共享复用)或一个内置SMTP会话，同一时刻只发一封邮件
+typedef struct {
+    CURL* curl;
+    smtp_client_t* smtp;     // 内置引擎的会话，第一次发送时连接
+    mail_sender_job_t* job;  // 正在发送的邮件，空闲时为NULL
+    double started;
+    mail_sender_stats_t stats;
+} mail_sender_conn_t;
+
+// 基于curl multi的发送引擎：单线程驱动最多connections个并发SMTP会话，
+// 把队列中的邮件依次分派给空闲的会话。每个会话只在第一封邮件时握手、登录，
+// 复用的连接被服务器断开(如达到单连接邮件数上限)时自动换新连接重发一次。
+// 一封邮件的全部收件人(To、Cc、Bcc)共用同一份MIME，在同一个会话上分批发送，
+// 单个收件人被拒绝不影响其他收件人，每个收件人的结果分别记录。
+// 配置了smtp_engine=native时改用内置SMTP客户端，每个会话一个线程
+typedef struct {
+    CURLM* multi;             // 内置引擎时为NULL
+    mail_sender_conn_t* conns;
+    int conn_count;
+    mail_sender_job_t* head;  // 待发送队列
+    mail_sender_job_t* tail;
+    size_t queued;
+    mail_sender_done_fn done;
+    void* done_arg;
+    mail_sender_stats_t total;
+    double elapsed;           // mail_sender_run累计的墙钟时间
+    size_t rcpt_limit;        // 当前单个事务的收件人数上限
+    mail_config_t config;     // 内置引擎建立新会话时使用
+    int extensions_mask;      // 内置引擎允许使用的SMTP_EXT_*扩展，默认全部
+    pthread_mutex_t lock;     // 内置引擎的各线程共享队列、rcpt_limit和done回调
+    char url[256];
+} mail_sender_t;
+
+// connections为并发会话数(1..MAIL_SENDER_MAX_CONNECTIONS)，done可以为NULL
+mail_sender_t* mail_sender_new(const mail_config_t* config, int connections,
+                               mail_sender_done_fn done, void* done_arg);
+
+// 生成MIME并加入队列，收件人取content->envelope，为NULL时取To、Cc、Bcc中的全部地址。
+// 正文、附件只被引用，必须在mail_sender_run返回前保持有效
+int mail_sender_queue(mail_sender_t* sender, const mail_content_t* content, void* user);
+
+// 发送队列中的全部邮件，返回时队列为空。全部成功返回1
+int mail_sender_run(mail_sender_t* sender);
+
+void mail_sender_free(mail_sender_t* sender);
+
+#endif // MAIL_SENDER_H
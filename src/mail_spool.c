@@ -0,0 +1,558 @@
+#include "mail_spool.h"
+#include "mail_sender.h"
+#include "crypto.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <openssl/evp.h>
+
+#define SPOOL_MAGIC "CRYOBX1"
+#define SPOOL_BATCH 256           // 每轮最多投递的邮件数
+#define SPOOL_POLL_INTERVAL_MS 500  // 守护进程检查新邮件的间隔
+#define SPOOL_HEX_LEN (MAIL_SPOOL_ID_LEN * 2 + 1)
+
+// 状态文件头，记录从其后开始
+typedef struct {
+    char magic[8];
+    uint32_t record_size;
+    uint32_t reserved;
+} mail_spool_header_t;
+
+// 一轮投递中正在发送的邮件，content的字段都指向data
+typedef struct {
+    size_t record;
+    char* data;
+    const char** attachments;
+    mail_content_t content;
+    char message_id[SPOOL_HEX_LEN + 16];
+} spool_job_t;
+
+typedef struct {
+    mail_spool_t* spool;
+    spool_job_t* jobs;
+    mail_spool_stats_t* stats;
+    int write_error;
+} spool_pass_t;
+
+static volatile sig_atomic_t daemon_stop = 0;
+
+static void hex_id(const unsigned char* id, char* out) {
+    static const char digits[] = "0123456789abcdef";
+    for (int i = 0; i < MAIL_SPOOL_ID_LEN; i++) {
+        out[i * 2] = digits[id[i] >> 4];
+        out[i * 2 + 1] = digits[id[i] & 0xF];
+    }
+    out[SPOOL_HEX_LEN - 1] = '\0';
+}
+
+static off_t record_offset(size_t i) {
+    return sizeof(mail_spool_header_t) + (off_t)i * sizeof(mail_spool_record_t);
+}
+
+// 检查文件头，新文件则写入文件头
+static int check_spool_header(int fd) {
+    mail_spool_header_t header;
+    ssize_t n = pread(fd, &header, sizeof(header), 0);
+
+    if (n == 0) {
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, SPOOL_MAGIC, sizeof(SPOOL_MAGIC));
+        header.record_size = sizeof(mail_spool_record_t);
+        return pwrite(fd, &header, sizeof(header), 0) == sizeof(header);
+    }
+
+    return n == sizeof(header)
+        && memcmp(header.magic, SPOOL_MAGIC, sizeof(SPOOL_MAGIC)) == 0
+        && header.record_size == sizeof(mail_spool_record_t);
+}
+
+// 文件中完整记录的条数，末尾被中断写入的半条记录不算
+static size_t index_count(int fd) {
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(mail_spool_header_t)) return 0;
+    return (st.st_size - sizeof(mail_spool_header_t)) / sizeof(mail_spool_record_t);
+}
+
+mail_spool_t* mail_spool_open(const char* spool_file, const char* index_file) {
+    mail_spool_t* spool = calloc(1, sizeof(mail_spool_t));
+    if (!spool) return NULL;
+
+    spool->data_fd = open(spool_file, O_RDWR | O_CREAT | O_APPEND, 0600);
+    spool->index_fd = open(index_file, O_RDWR | O_CREAT, 0600);
+    spool->by_id = hashmap_new(256);
+    if (spool->data_fd < 0 || spool->index_fd < 0 || !spool->by_id) {
+        mail_spool_close(spool);
+        return NULL;
+    }
+
+    // 多个进程可能同时创建队列，文件头在锁内写
+    flock(spool->index_fd, LOCK_EX);
+    int ok = check_spool_header(spool->index_fd);
+    flock(spool->index_fd, LOCK_UN);
+    if (!ok) {
+        mail_spool_close(spool);
+        return NULL;
+    }
+    return spool;
+}
+
+// 邮件数据：依次为From、To、Subject、正文、签名算法(都含结尾'\0')和签名，
+// 每个字段前是4字节长度；然后是附件个数和各附件的绝对路径，最后是Cc、Bcc、Message-ID
+// 和实际投递的收件人(空串表示全部收件人)，早先入队的邮件没有这几个字段
+static void put_field(char* data, size_t* offset, const void* value, uint32_t len) {
+    memcpy(data + *offset, &len, sizeof(len));
+    if (len) memcpy(data + *offset + sizeof(len), value, len);
+    *offset += sizeof(len) + len;
+}
+
+static const char* get_field(const char* data, size_t len, size_t* offset, uint32_t* field_len) {
+    uint32_t n;
+    if (len - *offset < sizeof(n)) return NULL;
+    memcpy(&n, data + *offset, sizeof(n));
+    if (len - *offset - sizeof(n) < n) return NULL;
+
+    const char* value = data + *offset + sizeof(n);
+    *offset += sizeof(n) + n;
+    if (field_len) *field_len = n;
+    return value;
+}
+
+// 取以'\0'结尾的字符串字段
+static const char* get_string(const char* data, size_t len, size_t* offset) {
+    uint32_t n = 0;
+    const char* value = get_field(data, len, offset, &n);
+    return value && n > 0 && value[n - 1] == '\0' ? value : NULL;
+}
+
+// 追加一封邮件的数据和记录，attempts和next_attempt为记录的初始值
+static int append_mail(mail_spool_t* spool, const mail_content_t* content,
+                       uint32_t attempts, int64_t next_attempt) {
+    if (!content->signature) return 0;
+
+    const char* alg = content->signature_alg ? content->signature_alg : SIG_ALG_RSA_SHA256;
+    const char* cc = content->cc ? content->cc : "";
+    const char* bcc = content->bcc ? content->bcc : "";
+    const char* envelope = content->envelope ? content->envelope : "";
+
+    // Message-ID在入队时确定并写进数据，内容相同的两次入队也是两封邮件，id各不相同
+    char generated_id[MAIL_MESSAGE_ID_MAX];
+    const char* message_id = content->message_id;
+    if (!message_id) {
+        if (!mail_new_message_id(generated_id, sizeof(generated_id))) return 0;
+        message_id = generated_id;
+    }
+    const char* strings[] = { content->from, content->to, content->subject, content->body, alg };
+    const int string_count = sizeof(strings) / sizeof(strings[0]);
+
+    // 投递进程的工作目录可能不同，附件保存绝对路径
+    char** paths = calloc(content->attachment_count + 1, sizeof(char*));
+    if (!paths) return 0;
+    size_t len = (string_count + 6) * sizeof(uint32_t) + content->signature_len
+               + strlen(cc) + 1 + strlen(bcc) + 1 + strlen(message_id) + 1 + strlen(envelope) + 1;
+    int ok = 1;
+    for (int i = 0; i < string_count; i++) len += strlen(strings[i]) + 1;
+    for (int i = 0; ok && i < content->attachment_count; i++) {
+        paths[i] = realpath(content->attachments[i], NULL);
+        ok = paths[i] != NULL;
+        if (ok) len += sizeof(uint32_t) + strlen(paths[i]) + 1;
+    }
+
+    char* data = ok ? malloc(len) : NULL;
+    mail_spool_record_t record;
+    memset(&record, 0, sizeof(record));
+    if (data) {
+        size_t offset = 0;
+        uint32_t count = content->attachment_count;
+        for (int i = 0; i < string_count; i++) put_field(data, &offset, strings[i], strlen(strings[i]) + 1);
+        put_field(data, &offset, content->signature, content->signature_len);
+        memcpy(data + offset, &count, sizeof(count));
+        offset += sizeof(count);
+        for (int i = 0; i < content->attachment_count; i++) put_field(data, &offset, paths[i], strlen(paths[i]) + 1);
+        put_field(data, &offset, cc, strlen(cc) + 1);
+        put_field(data, &offset, bcc, strlen(bcc) + 1);
+        put_field(data, &offset, message_id, strlen(message_id) + 1);
+        put_field(data, &offset, envelope, strlen(envelope) + 1);
+
+        unsigned int id_len = 0;
+        record.length = len;
+        record.state = MAIL_SPOOL_PENDING;
+        record.created = time(NULL);
+        record.attempts = attempts;
+        record.next_attempt = next_attempt ? next_attempt : record.created;
+        ok = EVP_Digest(data, len, record.id, &id_len, EVP_sha256(), NULL) && id_len == MAIL_SPOOL_ID_LEN;
+    } else {
+        ok = 0;
+    }
+
+    // 先写数据再追加记录，锁保证偏移和记录位置不和其他生产者交错
+    if (ok) {
+        flock(spool->index_fd, LOCK_EX);
+        off_t offset = lseek(spool->data_fd, 0, SEEK_END);
+        record.offset = offset;
+        ok = offset >= 0
+          && write(spool->data_fd, data, len) == (ssize_t)len
+          && pwrite(spool->index_fd, &record, sizeof(record),
+                    record_offset(index_count(spool->index_fd))) == sizeof(record);
+        flock(spool->index_fd, LOCK_UN);
+    }
+
+    for (int i = 0; i < content->attachment_count; i++) free(paths[i]);
+    free(paths);
+    free(data);
+    return ok;
+}
+
+int mail_spool_enqueue(mail_spool_t* spool, const mail_content_t* content) {
+    return append_mail(spool, content, 0, 0);
+}
+
+static int write_record(mail_spool_t* spool, size_t i) {
+    return pwrite(spool->index_fd, &spool->records[i], sizeof(mail_spool_record_t),
+                  record_offset(i)) == sizeof(mail_spool_record_t);
+}
+
+// 读入生产者新追加的记录，和队列中尚未投递的邮件完全相同(同一Message-ID重复入队)的标为重复
+static int load_new_records(mail_spool_t* spool, mail_spool_stats_t* stats) {
+    size_t count = index_count(spool->index_fd);
+    if (count <= spool->record_count) return 1;
+
+    if (count > spool->record_cap) {
+        size_t cap = spool->record_cap ? spool->record_cap : 64;
+        while (cap < count) cap *= 2;
+        mail_spool_record_t* records = realloc(spool->records, cap * sizeof(mail_spool_record_t));
+        if (!records) return 0;
+        spool->records = records;
+        spool->record_cap = cap;
+    }
+
+    size_t bytes = (count - spool->record_count) * sizeof(mail_spool_record_t);
+    if (pread(spool->index_fd, spool->records + spool->record_count, bytes,
+              record_offset(spool->record_count)) != (ssize_t)bytes) {
+        return 0;
+    }
+
+    // 新邮件的数据先落盘，之后的状态更新才有意义
+    fdatasync(spool->data_fd);
+
+    char key[SPOOL_HEX_LEN];
+    for (size_t i = spool->record_count; i < count; i++) {
+        mail_spool_record_t* record = &spool->records[i];
+        if (record->state != MAIL_SPOOL_PENDING) continue;
+
+        hex_id(record->id, key);
+        size_t slot = (size_t)(intptr_t)hashmap_get(spool->by_id, key);
+        if (slot && spool->records[slot - 1].state == MAIL_SPOOL_PENDING) {
+            record->state = MAIL_SPOOL_DUPLICATE;
+            if (!write_record(spool, i)) return 0;
+            stats->duplicates++;
+            continue;
+        }
+        hashmap_put(spool->by_id, key, (void*)(intptr_t)(i + 1));
+    }
+    spool->record_count = count;
+    return 1;
+}
+
+static void set_error(mail_spool_record_t* record, const char* error) {
+    size_t len = strlen(error);
+    if (len >= sizeof(record->error)) len = sizeof(record->error) - 1;
+    memcpy(record->error, error, len);
+    record->error[len] = '\0';
+}
+
+// 第attempts次失败后的下次投递时间
+static int64_t retry_time(uint32_t attempts) {
+    int64_t delay = MAIL_SPOOL_RETRY_BASE;
+    for (uint32_t i = 1; i < attempts && delay < MAIL_SPOOL_RETRY_MAX; i++) delay *= 2;
+    if (delay > MAIL_SPOOL_RETRY_MAX) delay = MAIL_SPOOL_RETRY_MAX;
+    return time(NULL) + delay;
+}
+
+// 记一次失败：按指数退避推迟，重试次数用完则放弃
+static void record_failure(mail_spool_record_t* record, const char* error, mail_spool_stats_t* stats) {
+    record->attempts++;
+    set_error(record, error);
+    if (record->attempts >= MAIL_SPOOL_MAX_ATTEMPTS) {
+        record->state = MAIL_SPOOL_FAILED;
+        stats->failed++;
+        return;
+    }
+
+    record->next_attempt = retry_time(record->attempts);
+    stats->deferred++;
+}
+
+// 读出一封邮件并校验，content的字段指向job->data
+static int load_job(mail_spool_t* spool, spool_job_t* job) {
+    const mail_spool_record_t* record = &spool->records[job->record];
+    size_t len = record->length;
+    job->data = malloc(len ? len : 1);
+    if (!job->data || pread(spool->data_fd, job->data, len, record->offset) != (ssize_t)len) return 0;
+
+    unsigned char id[EVP_MAX_MD_SIZE];
+    unsigned int id_len = 0;
+    if (!EVP_Digest(job->data, len, id, &id_len, EVP_sha256(), NULL)
+        || id_len != MAIL_SPOOL_ID_LEN || memcmp(id, record->id, MAIL_SPOOL_ID_LEN) != 0) {
+        return 0;
+    }
+
+    mail_content_t* content = &job->content;
+    size_t offset = 0;
+    uint32_t sig_len = 0, count = 0;
+    content->from = get_string(job->data, len, &offset);
+    content->to = get_string(job->data, len, &offset);
+    content->subject = get_string(job->data, len, &offset);
+    content->body = get_string(job->data, len, &offset);
+    content->signature_alg = get_string(job->data, len, &offset);
+    content->signature = (const unsigned char*)get_field(job->data, len, &offset, &sig_len);
+    content->signature_len = sig_len;
+    if (!content->from || !content->to || !content->subject || !content->body
+        || !content->signature_alg || !content->signature || len - offset < sizeof(count)) {
+        return 0;
+    }
+    memcpy(&count, job->data + offset, sizeof(count));
+    offset += sizeof(count);
+    if (count > (len - offset) / sizeof(uint32_t)) return 0;
+
+    job->attachments = calloc(count + 1, sizeof(char*));
+    if (!job->attachments) return 0;
+    for (uint32_t i = 0; i < count; i++) {
+        job->attachments[i] = get_string(job->data, len, &offset);
+        if (!job->attachments[i]) return 0;
+    }
+    content->attachments = job->attachments;
+    content->attachment_count = count;
+    if (offset < len) {
+        content->cc = get_string(job->data, len, &offset);
+        content->bcc = get_string(job->data, len, &offset);
+        if (!content->cc || !content->bcc) return 0;
+    }
+
+    // 每次重试使用入队时确定的Message-ID，收件方可以据此丢弃重复投递的副本；
+    // 早先入队的邮件没有保存，由记录id得到
+    if (offset < len) {
+        content->message_id = get_string(job->data, len, &offset);
+        if (!content->message_id) return 0;
+    } else {
+        char key[SPOOL_HEX_LEN];
+        hex_id(record->id, key);
+        snprintf(job->message_id, sizeof(job->message_id), "<%s@crymail>", key);
+        content->message_id = job->message_id;
+    }
+    if (offset < len) {
+        content->envelope = get_string(job->data, len, &offset);
+        if (!content->envelope) return 0;
+        if (!*content->envelope) content->envelope = NULL;
+    }
+    return 1;
+}
+
+// 队列只保存附件路径，投递时文件可能已被修改：重新计算摘要，与签名覆盖的摘要比对
+static int attachments_unchanged(const mail_content_t* content) {
+    for (int i = 0; i < content->attachment_count; i++) {
+        unsigned char signed_digest[MIME_DIGEST_LEN];
+        unsigned char digest[EVP_MAX_MD_SIZE];
+        unsigned int digest_len = 0;
+        if (!mail_attachment_digest(content, i, signed_digest)) continue;
+        // 读不到文件留给mail_sender_queue按失败重试
+        if (!calculate_digest_file(content->attachments[i], digest, &digest_len)) continue;
+        if (digest_len != MIME_DIGEST_LEN || memcmp(digest, signed_digest, MIME_DIGEST_LEN) != 0) return 0;
+    }
+    return 1;
+}
+
+// 每封邮件发完立即更新它的记录，整轮结束后统一同步到磁盘
+static void delivered(void* user, const mail_sender_result_t* result, void* arg) {
+    spool_pass_t* pass = (spool_pass_t*)arg;
+    const spool_job_t* job = &pass->jobs[(size_t)(intptr_t)user];
+    mail_spool_record_t* record = &pass->spool->records[job->record];
+
+    if (result->ok) {
+        record->state = MAIL_SPOOL_SENT;
+        record->attempts++;
+        record->error[0] = '\0';
+        pass->stats->sent++;
+    } else if ((!result->delivered && !result->rejected) || !result->retry) {
+        record_failure(record, "SMTP投递失败", pass->stats);
+    } else {
+        // 部分收件人已有结果：这条记录到此为止，其余收件人带着同一个Message-ID作为新记录
+        // 继续按退避重试，已经收到的收件人不会再收到一份
+        uint32_t attempts = record->attempts + 1;
+        int requeue = *result->retry && attempts < MAIL_SPOOL_MAX_ATTEMPTS;
+        mail_content_t rest = job->content;
+        rest.envelope = result->retry;
+        if (requeue && !append_mail(pass->spool, &rest, attempts, retry_time(attempts))) {
+            // 存不下其余收件人时整封重试，宁可重复也不丢
+            record_failure(record, "SMTP投递失败", pass->stats);
+        } else {
+            record->attempts = attempts;
+            record->state = result->delivered ? MAIL_SPOOL_SENT : MAIL_SPOOL_FAILED;
+            set_error(record, !*result->retry ? "部分收件人被拒绝"
+                            : requeue ? "其余收件人稍后重试" : "其余收件人重试次数用完");
+            if (result->delivered) pass->stats->sent++;
+            else pass->stats->failed++;
+            if (requeue) pass->stats->deferred++;
+        }
+    }
+    if (!write_record(pass->spool, job->record)) pass->write_error = 1;
+}
+
+int mail_spool_deliver(mail_spool_t* spool, const mail_config_t* config,
+                       int connections, mail_spool_stats_t* stats) {
+    memset(stats, 0, sizeof(*stats));
+    if (!load_new_records(spool, stats)) return 0;
+
+    time_t now = time(NULL);
+    spool_job_t* jobs = calloc(SPOOL_BATCH, sizeof(spool_job_t));
+    if (!jobs) return 0;
+    size_t job_count = 0;
+    for (size_t i = 0; i < spool->record_count && job_count < SPOOL_BATCH; i++) {
+        const mail_spool_record_t* record = &spool->records[i];
+        if (record->state == MAIL_SPOOL_PENDING && record->next_attempt <= now) {
+            jobs[job_count++].record = i;
+        }
+    }
+
+    spool_pass_t pass = { spool, jobs, stats, 0 };
+    mail_sender_t* sender = job_count ? mail_sender_new(config, connections, delivered, &pass) : NULL;
+    for (size_t j = 0; sender && j < job_count; j++) {
+        mail_spool_record_t* record = &spool->records[jobs[j].record];
+        if (!load_job(spool, &jobs[j])) {
+            // 数据损坏，重试也无法恢复
+            record->state = MAIL_SPOOL_FAILED;
+            set_error(record, "队列数据损坏");
+            stats->failed++;
+            if (!write_record(spool, jobs[j].record)) pass.write_error = 1;
+        } else if (!attachments_unchanged(&jobs[j].content)) {
+            // 签名已经不覆盖现在的附件，重试也不会恢复
+            record->state = MAIL_SPOOL_FAILED;
+            set_error(record, "附件在入队后被修改");
+            stats->failed++;
+            if (!write_record(spool, jobs[j].record)) pass.write_error = 1;
+        } else if (!mail_sender_queue(sender, &jobs[j].content, (void*)(intptr_t)j)) {
+            // 通常是附件已被删除，留给下次重试
+            record_failure(record, "无法生成邮件", stats);
+            if (!write_record(spool, jobs[j].record)) pass.write_error = 1;
+        }
+    }
+    if (sender) {
+        mail_sender_run(sender);
+        mail_sender_free(sender);
+    } else if (job_count) {
+        pass.write_error = 1;
+    }
+
+    for (size_t j = 0; j < job_count; j++) {
+        free(jobs[j].attachments);
+        free(jobs[j].data);
+    }
+    free(jobs);
+
+    // 检查点：本轮的结果全部落盘后才开始下一轮
+    if (job_count && fdatasync(spool->index_fd) != 0) pass.write_error = 1;
+
+    for (size_t i = 0; i < spool->record_count; i++) {
+        const mail_spool_record_t* record = &spool->records[i];
+        if (record->state != MAIL_SPOOL_PENDING) continue;
+        stats->pending++;
+        if (!stats->next_due || record->next_attempt < stats->next_due) stats->next_due = record->next_attempt;
+    }
+    return !pass.write_error;
+}
+
+int mail_spool_compact(mail_spool_t* spool) {
+    flock(spool->index_fd, LOCK_EX);
+
+    // 加锁后还有新记录说明生产者刚刚入队，留到下一轮
+    int idle = index_count(spool->index_fd) == spool->record_count;
+    for (size_t i = 0; idle && i < spool->record_count; i++) {
+        idle = spool->records[i].state != MAIL_SPOOL_PENDING;
+    }
+
+    int ok = 1;
+    if (idle && spool->record_count) {
+        ok = ftruncate(spool->index_fd, sizeof(mail_spool_header_t)) == 0
+          && ftruncate(spool->data_fd, 0) == 0
+          && fdatasync(spool->index_fd) == 0;
+        if (ok) {
+            spool->record_count = 0;
+            hashmap_free(spool->by_id, NULL);
+            spool->by_id = hashmap_new(256);
+            ok = spool->by_id != NULL;
+        }
+    }
+
+    flock(spool->index_fd, LOCK_UN);
+    return ok;
+}
+
+void mail_spool_close(mail_spool_t* spool) {
+    if (!spool) return;
+
+    if (spool->data_fd >= 0) close(spool->data_fd);
+    if (spool->index_fd >= 0) close(spool->index_fd);
+    hashmap_free(spool->by_id, NULL);
+    free(spool->records);
+    free(spool);
+}
+
+static void stop_daemon(int sig) {
+    (void)sig;
+    daemon_stop = 1;
+}
+
+int run_spool_daemon(const mail_config_t* config, int connections) {
+    mail_spool_t* spool = mail_spool_open(MAIL_SPOOL_FILE, MAIL_SPOOL_INDEX_FILE);
+    if (!spool) {
+        printf("无法打开发件队列%s\n", MAIL_SPOOL_FILE);
+        return 0;
+    }
+    // 同一队列只允许一个投递进程
+    if (flock(spool->data_fd, LOCK_EX | LOCK_NB) != 0) {
+        printf("已有投递进程在处理%s\n", MAIL_SPOOL_FILE);
+        mail_spool_close(spool);
+        return 0;
+    }
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = stop_daemon;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    printf("投递进程已启动，队列%s，并发连接%d\n", MAIL_SPOOL_FILE, connections);
+    fflush(stdout);
+
+    int ok = 1;
+    while (!daemon_stop) {
+        mail_spool_stats_t stats;
+        if (!mail_spool_deliver(spool, config, connections, &stats)) {
+            printf("发件队列读写失败\n");
+            ok = 0;
+            break;
+        }
+        if (stats.sent || stats.deferred || stats.failed || stats.duplicates) {
+            printf("投递成功%zu封, 推迟重试%zu封, 放弃%zu封, 重复%zu封, 等待中%zu封\n",
+                   stats.sent, stats.deferred, stats.failed, stats.duplicates, stats.pending);
+            fflush(stdout);
+        }
+        if (!stats.pending && !mail_spool_compact(spool)) {
+            printf("清理发件队列失败\n");
+        }
+
+        // 还有到期的邮件(超过一轮的批量)就立即继续，否则等待新邮件或下一次重试
+        if (stats.pending && stats.next_due <= time(NULL)) continue;
+        struct timespec ts = { SPOOL_POLL_INTERVAL_MS / 1000, (SPOOL_POLL_INTERVAL_MS % 1000) * 1000000L };
+        while (nanosleep(&ts, &ts) != 0 && errno == EINTR && !daemon_stop) {}
+    }
+
+    printf("投递进程退出\n");
+    mail_spool_close(spool);
+    return ok;
+}
@@ -0,0 +1,81 @@
+#ifndef MAIL_SPOOL_H
+#define MAIL_SPOOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include "mail.h"
+#include "hashmap.h"
+
+#define MAIL_SPOOL_FILE "outbox.spool"  // 追加写入的待发邮件
+#define MAIL_SPOOL_INDEX_FILE "outbox.idx"  // 定长投递状态记录
+#define MAIL_SPOOL_ID_LEN 32  // SHA-256
+
+// 投递状态
+#define MAIL_SPOOL_PENDING   0  // 等待(重新)投递
+#define MAIL_SPOOL_SENT      1  // 已投递
+#define MAIL_SPOOL_FAILED    2  // 重试次数用完或数据损坏，不再投递
+#define MAIL_SPOOL_DUPLICATE 3  // 同一封邮件(Message-ID和内容都相同)重复入队，只投递一次
+
+// 重试间隔从MAIL_SPOOL_RETRY_BASE秒开始每次翻倍，最长MAIL_SPOOL_RETRY_MAX秒
+#define MAIL_SPOOL_RETRY_BASE 15
+#define MAIL_SPOOL_RETRY_MAX 3600
+#define MAIL_SPOOL_MAX_ATTEMPTS 10
+
+// 定长状态记录(128字节)
+typedef struct {
+    uint64_t offset;        // 邮件数据在outbox.spool中的偏移
+    uint32_t length;
+    uint32_t state;         // MAIL_SPOOL_*
+    uint32_t attempts;      // 已尝试投递的次数
+    uint32_t reserved;
+    int64_t created;        // 入队时间(Unix秒)
+    int64_t next_attempt;   // 下次可以投递的时间
+    unsigned char id[MAIL_SPOOL_ID_LEN];  // 邮件数据(含Message-ID)的SHA-256，兼作校验和与去重键
+    char error[56];         // 最近一次失败原因
+} mail_spool_record_t;
+
+// 一轮投递的计数
+typedef struct {
+    size_t pending;     // 本轮结束后仍在等待的邮件
+    size_t sent;
+    size_t deferred;    // 失败后推迟重试
+    size_t failed;      // 放弃投递
+    size_t duplicates;
+    time_t next_due;    // 最早的下次投递时间，没有待投递邮件时为0
+} mail_spool_stats_t;
+
+// 发件队列：生产者加锁追加邮件和记录后立即返回，投递进程按记录顺序取出到期的邮件发送，
+// 每封邮件的结果原地更新到它的记录中。记录只在邮件数据写完之后追加，
+// 崩溃时最多留下没有记录的数据或不完整的末尾记录，重新打开时都会被忽略
+typedef struct {
+    int data_fd;
+    int index_fd;
+    mail_spool_record_t* records;  // 投递进程读入的记录
+    size_t record_count;
+    size_t record_cap;
+    hashmap_t* by_id;   // 十六进制id -> 记录号+1，用于合并重复入队的邮件
+} mail_spool_t;
+
+// 打开(不存在则创建)发件队列
+mail_spool_t* mail_spool_open(const char* spool_file, const char* index_file);
+
+// 把一封签名好的邮件加入队列，只写本地文件，不连接服务器。
+// 签名必须已在content->signature中，附件路径转为绝对路径保存。
+// content->message_id为NULL时生成新的，每次入队都是一封独立的邮件，只有它自己的重试共用Message-ID
+int mail_spool_enqueue(mail_spool_t* spool, const mail_content_t* content);
+
+// 投递一轮：读入新的记录，把到期的待投递邮件通过最多connections个会话发出，
+// 结果写回记录并同步到磁盘。返回0表示队列文件读写出错
+int mail_spool_deliver(mail_spool_t* spool, const mail_config_t* config,
+                       int connections, mail_spool_stats_t* stats);
+
+// 没有待投递的邮件时清空队列文件
+int mail_spool_compact(mail_spool_t* spool);
+
+void mail_spool_close(mail_spool_t* spool);
+
+// 投递守护循环：反复投递并等待下一封到期的邮件，收到SIGINT/SIGTERM后在本轮结束时退出
+int run_spool_daemon(const mail_config_t* config, int connections);
+
+#endif // MAIL_SPOOL_H
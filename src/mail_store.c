@@ -0,0 +1,228 @@
+#include "mail_store.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define INDEX_MAGIC "CRYIDX1"
+
+// 索引文件头，记录从其后开始
+typedef struct {
+    char magic[8];
+    uint32_t record_size;
+    uint32_t reserved;
+} mail_index_header_t;
+
+// 复制字符串到定长字段，超长截断
+static void copy_field(char* dst, size_t size, const char* src) {
+    size_t len = src ? strlen(src) : 0;
+    if (len >= size) len = size - 1;
+    if (len) memcpy(dst, src, len);
+    dst[len] = '\0';
+}
+
+static off_t record_offset(size_t i) {
+    return sizeof(mail_index_header_t) + (off_t)i * sizeof(mail_record_t);
+}
+
+// 检查文件头，新文件则写入文件头
+static int check_index_header(int fd) {
+    mail_index_header_t header;
+    ssize_t n = pread(fd, &header, sizeof(header), 0);
+
+    if (n == 0) {
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+        header.record_size = sizeof(mail_record_t);
+        return pwrite(fd, &header, sizeof(header), 0) == sizeof(header);
+    }
+
+    return n == sizeof(header)
+        && memcmp(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) == 0
+        && header.record_size == sizeof(mail_record_t);
+}
+
+mail_store_t* mail_store_open(const char* store_file, const char* index_file) {
+    mail_store_t* store = malloc(sizeof(mail_store_t));
+    if (!store) return NULL;
+
+    store->store_fd = open(store_file, O_RDWR | O_CREAT | O_APPEND, 0600);
+    store->index_fd = open(index_file, O_RDWR | O_CREAT, 0600);
+    store->record_count = 0;
+    store->by_uid = NULL;
+    store->pending_offset = 0;
+    store->pending_len = 0;
+    store->pending_error = 0;
+
+    if (store->store_fd < 0 || store->index_fd < 0 || !check_index_header(store->index_fd)) {
+        mail_store_close(store);
+        return NULL;
+    }
+
+    // 建立uid到记录号的映射，用于去重和补全邮件头
+    struct stat st;
+    fstat(store->index_fd, &st);
+    store->record_count = (st.st_size - sizeof(mail_index_header_t)) / sizeof(mail_record_t);
+    store->by_uid = hashmap_new(store->record_count + 64);
+
+    mail_record_t record;
+    for (size_t i = 0; i < store->record_count; i++) {
+        if (pread(store->index_fd, &record, sizeof(record), record_offset(i)) != sizeof(record)) break;
+        hashmap_put(store->by_uid, record.uid, (void*)(intptr_t)(i + 1));
+    }
+
+    return store;
+}
+
+// 取截断到索引字段长度的uid及其记录号(+1)，不存在返回0
+static size_t find_slot(const mail_store_t* store, const char* item_uid, char* uid) {
+    // 索引中的uid可能被截断，查找时也用截断后的值
+    copy_field(uid, sizeof(((mail_record_t*)0)->uid), item_uid);
+    return (size_t)(intptr_t)hashmap_get(store->by_uid, uid);
+}
+
+int mail_store_get(mail_store_t* store, const char* item_uid, mail_record_t* record) {
+    char uid[sizeof(((mail_record_t*)0)->uid)];
+    size_t slot = find_slot(store, item_uid, uid);
+    return slot && pread(store->index_fd, record, sizeof(*record), record_offset(slot - 1)) == sizeof(*record);
+}
+
+int mail_store_wants(mail_store_t* store, const char* item_uid, int complete) {
+    mail_record_t old;
+    if (!mail_store_get(store, item_uid, &old)) return 1;
+    // 已有完整邮件，或者这次同样只有邮件头，都不需要再写
+    return !(old.flags & MAIL_RECORD_COMPLETE) && complete;
+}
+
+int mail_store_begin(mail_store_t* store) {
+    off_t offset = lseek(store->store_fd, 0, SEEK_END);
+    store->pending_offset = offset;
+    store->pending_len = 0;
+    store->pending_error = offset < 0;
+    return !store->pending_error;
+}
+
+int mail_store_append(mail_store_t* store, const char* data, size_t len) {
+    if (store->pending_error) return 0;
+    if (write(store->store_fd, data, len) != (ssize_t)len) {
+        store->pending_error = 1;
+        return 0;
+    }
+    store->pending_len += len;
+    return 1;
+}
+
+int mail_store_commit(mail_store_t* store, const mail_item_t* item) {
+    if (store->pending_error || !item->uid) return 0;
+
+    // 原始邮件已经先写入，索引永远不会指向不存在的数据
+    char uid[sizeof(((mail_record_t*)0)->uid)];
+    size_t slot = find_slot(store, item->uid, uid);
+
+    mail_record_t record;
+    memset(&record, 0, sizeof(record));
+    record.offset = store->pending_offset;
+    record.length = store->pending_len;
+    record.flags = (item->has_signature > 0 ? MAIL_RECORD_SIGNED : 0)
+                 | (item->has_signature < 0 ? MAIL_RECORD_SIGNATURE_UNKNOWN : 0)
+                 | (item->complete ? MAIL_RECORD_COMPLETE : 0);
+    memcpy(record.uid, uid, sizeof(record.uid));
+    copy_field(record.from, sizeof(record.from), item->from);
+    copy_field(record.date, sizeof(record.date), item->date);
+    copy_field(record.subject, sizeof(record.subject), item->subject);
+
+    size_t i = slot ? slot - 1 : store->record_count;
+    if (pwrite(store->index_fd, &record, sizeof(record), record_offset(i)) != sizeof(record)) return 0;
+
+    if (!slot) {
+        store->record_count++;
+        hashmap_put(store->by_uid, record.uid, (void*)(intptr_t)(i + 1));
+    }
+    return 1;
+}
+
+void mail_store_abort(mail_store_t* store) {
+    // 只有一个写入者，begin之后追加的都是这封邮件的数据
+    if (ftruncate(store->store_fd, store->pending_offset) == 0) {
+        store->pending_len = 0;
+    }
+}
+
+int mail_store_put(mail_store_t* store, const mail_item_t* item,
+                   const char* raw, size_t raw_len) {
+    if (!item->uid) return 0;
+    if (!mail_store_wants(store, item->uid, item->complete)) return 1;
+
+    if (!mail_store_begin(store)) return 0;
+    if (mail_store_append(store, raw, raw_len) && mail_store_commit(store, item)) return 1;
+    mail_store_abort(store);
+    return 0;
+}
+
+void mail_store_close(mail_store_t* store) {
+    if (!store) return;
+
+    if (store->store_fd >= 0) close(store->store_fd);
+    if (store->index_fd >= 0) close(store->index_fd);
+    hashmap_free(store->by_uid, NULL);
+    free(store);
+}
+
+int mail_index_map(mail_index_view_t* view, const char* store_file, const char* index_file) {
+    memset(view, 0, sizeof(*view));
+
+    int fd = open(index_file, O_RDONLY);
+    if (fd < 0) return 0;
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size <= sizeof(mail_index_header_t) || !check_index_header(fd)) {
+        close(fd);
+        return 0;
+    }
+
+    view->map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (view->map == MAP_FAILED) {
+        view->map = NULL;
+        return 0;
+    }
+
+    view->map_len = st.st_size;
+    view->records = (const mail_record_t*)((const char*)view->map + sizeof(mail_index_header_t));
+    view->count = (st.st_size - sizeof(mail_index_header_t)) / sizeof(mail_record_t);
+
+    // 邮件库也整体映射，阅读邮件时直接在映射区上解析
+    fd = open(store_file, O_RDONLY);
+    if (fd >= 0) {
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void* store = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+            if (store != MAP_FAILED) {
+                view->store = store;
+                view->store_len = st.st_size;
+            }
+        }
+        close(fd);
+    }
+    return view->count > 0;
+}
+
+const char* mail_index_raw(const mail_index_view_t* view, size_t i, size_t* len) {
+    if (i >= view->count || !view->store) return NULL;
+
+    const mail_record_t* record = &view->records[i];
+    if (record->offset > view->store_len || record->length > view->store_len - record->offset) {
+        return NULL;
+    }
+    if (len) *len = record->length;
+    return view->store + record->offset;
+}
+
+void mail_index_unmap(mail_index_view_t* view) {
+    if (view->map) munmap(view->map, view->map_len);
+    if (view->store) munmap((void*)view->store, view->store_len);
+    memset(view, 0, sizeof(*view));
+}
@@ -0,0 +1,81 @@
+#ifndef MAIL_STORE_H
+#define MAIL_STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "mail.h"
+#include "hashmap.h"
+
+#define MAIL_STORE_FILE "mail.store"  // 追加写入的原始邮件
+#define MAIL_INDEX_FILE "mail.idx"    // 定长索引记录
+
+// 索引记录标志
+#define MAIL_RECORD_SIGNED   0x1  // 含数字签名
+#define MAIL_RECORD_COMPLETE 0x2  // 存的是完整邮件(否则只有TOP取回的邮件头)
+#define MAIL_RECORD_SIGNATURE_UNKNOWN 0x4  // 只有邮件头，无法判断是否含签名
+
+// 定长索引记录(512字节)，字符串字段保证以'\0'结尾
+typedef struct {
+    uint64_t offset;    // 原始邮件在mail.store中的偏移
+    uint32_t length;    // 原始邮件长度
+    uint32_t flags;
+    char uid[72];
+    char from[128];
+    char date[64];
+    char subject[232];
+} mail_record_t;
+
+// 可写的本地邮件库
+typedef struct {
+    int store_fd;
+    int index_fd;
+    size_t record_count;
+    hashmap_t* by_uid;  // uid -> 记录号+1
+    uint64_t pending_offset;  // 正在写入的邮件起点
+    size_t pending_len;
+    int pending_error;
+} mail_store_t;
+
+// 只读映射的索引视图
+typedef struct {
+    void* map;
+    size_t map_len;
+    const mail_record_t* records;
+    size_t count;
+    const char* store;  // 映射的mail.store，不存在时为NULL
+    size_t store_len;
+} mail_index_view_t;
+
+// 打开(不存在则创建)本地邮件库
+mail_store_t* mail_store_open(const char* store_file, const char* index_file);
+
+// 保存一封邮件；同一uid已有完整邮件时跳过，只有邮件头时用完整邮件替换索引记录
+int mail_store_put(mail_store_t* store, const mail_item_t* item,
+                   const char* raw, size_t raw_len);
+
+// 按uid取索引记录(uid按记录字段长度截断后查找)，没有时返回0
+int mail_store_get(mail_store_t* store, const char* uid, mail_record_t* record);
+
+// 流式保存：先用mail_store_wants判断是否需要保存，
+// 再begin、边下载边append、解析完成后commit写入索引记录
+int mail_store_wants(mail_store_t* store, const char* uid, int complete);
+int mail_store_begin(mail_store_t* store);
+int mail_store_append(mail_store_t* store, const char* data, size_t len);
+int mail_store_commit(mail_store_t* store, const mail_item_t* item);
+// 不提交时放弃本次写入，把邮件库截回begin时的长度
+void mail_store_abort(mail_store_t* store);
+
+// 关闭本地邮件库
+void mail_store_close(mail_store_t* store);
+
+// 以mmap方式打开索引，失败或为空返回0
+int mail_index_map(mail_index_view_t* view, const char* store_file, const char* index_file);
+
+// 取第i条记录对应的原始邮件，直接指向映射区不复制(不以'\0'结尾)，
+// 在mail_index_unmap之前有效；记录越界或超出邮件库范围时返回NULL
+const char* mail_index_raw(const mail_index_view_t* view, size_t i, size_t* len);
+
+// 解除索引映射
+void mail_index_unmap(mail_index_view_t* view);
+
+#endif // MAIL_STORE_H
@@ -0,0 +1,196 @@
+#include "mail_verify.h"
+#include "base64.h"
+#include "crypto.h"
+#include "keyring.h"
+#include "hashmap.h"
+#include "thread_pool.h"
+#include <stdlib.h>
+#include <string.h>
+
+// 常见签名解码后都放得下，超长时才分配
+#define SIG_STACK_MAX 1024
+
+int mail_verify_signature(EVP_MD_CTX* md, EVP_PKEY* pkey,
+                          const char* body, size_t body_len,
+                          const char* signature, size_t sig_len,
+                          const char* alg, size_t alg_len) {
+    int flags = 0;
+    if (alg_len == 0) {
+        flags = SIG_LEGACY_DOUBLE_HASH;
+        alg = SIG_ALG_RSA_SHA256;
+        alg_len = strlen(alg);
+    }
+    if (!sig_alg_matches(pkey, alg, alg_len)) return MAIL_SIG_INVALID;
+
+    // Base64解码签名，签名可能按76列折行
+    unsigned char stack_buf[SIG_STACK_MAX];
+    size_t max = base64_decoded_max(sig_len);
+    unsigned char* decoded = max <= sizeof(stack_buf) ? stack_buf : malloc(max);
+    if (!decoded) return MAIL_SIG_INVALID;
+
+    size_t decoded_len = 0;
+    base64_decoder_t decoder;
+    base64_decoder_init(&decoder);
+    int status = MAIL_SIG_INVALID;
+
+    if (base64_decode_update(&decoder, signature, sig_len, decoded, &decoded_len)
+        && base64_decode_final(&decoder)) {
+        EVP_MD_CTX* ctx = md ? md : EVP_MD_CTX_new();
+        int ok = ctx && verify_signature_md(ctx, pkey, body, body_len, decoded, decoded_len, flags);
+        status = ok ? MAIL_SIG_VERIFIED : MAIL_SIG_FAILED;
+        if (!md) EVP_MD_CTX_free(ctx);
+    }
+
+    if (decoded != stack_buf) free(decoded);
+    return status;
+}
+
+// 一个验签公钥，指纹在需要查缓存时计算
+typedef struct {
+    EVP_PKEY* pkey;
+    unsigned char fingerprint[VERIFY_CACHE_ID_LEN];
+    int has_fingerprint;
+} verify_key_t;
+
+typedef struct {
+    mail_list_t* list;
+    verify_key_t** keys;  // 每封邮件的公钥，NULL表示找不到发件人公钥
+    verify_cache_t* cache;
+} verify_job_t;
+
+static void* verify_thread_init(void* arg) {
+    (void)arg;
+    return EVP_MD_CTX_new();
+}
+
+static void verify_thread_done(void* state, void* arg) {
+    (void)arg;
+    EVP_MD_CTX_free((EVP_MD_CTX*)state);
+}
+
+static void verify_one(size_t index, void* state, void* arg) {
+    verify_job_t* job = (verify_job_t*)arg;
+    mail_item_t* item = &job->list->items[index];
+    verify_key_t* key = job->keys[index];
+
+    if (!item->has_signature) {
+        item->verify_status = MAIL_SIG_UNSIGNED;
+    } else if (!item->complete || !state) {
+        item->verify_status = MAIL_SIG_UNCHECKED;
+    } else if (!key) {
+        item->verify_status = MAIL_SIG_NO_KEY;
+    } else {
+        EVP_MD_CTX* md = (EVP_MD_CTX*)state;
+        size_t body_len = strlen(item->body);
+        size_t alg_len = item->signature_alg ? strlen(item->signature_alg) : 0;
+
+        // 缓存命中只需要对邮件做一次SHA-256
+        unsigned char id[VERIFY_CACHE_ID_LEN];
+        int cached = job->cache && key->has_fingerprint
+            && verify_cache_id(md, item->message_id, item->body, body_len,
+                               item->signature_file, item->signature_file_len,
+                               item->signature_alg, alg_len, id);
+        int status = cached ? verify_cache_get(job->cache, id, key->fingerprint) : MAIL_SIG_UNCHECKED;
+
+        if (status == MAIL_SIG_UNCHECKED) {
+            status = mail_verify_signature(md, key->pkey, item->body, body_len,
+                                           item->signature_file, item->signature_file_len,
+                                           item->signature_alg, alg_len);
+            if (cached) verify_cache_put(job->cache, id, key->fingerprint, status);
+        }
+        // 缓存只记签名结果，附件摘要在解析时已算好，每次都核对
+        if (status == MAIL_SIG_VERIFIED && !mail_verify_attachments(item->body, body_len, item->attachments)) {
+            status = MAIL_SIG_FAILED;
+        }
+        item->verify_status = status;
+    }
+}
+
+static void run_verify(mail_list_t* list, verify_key_t** keys, verify_cache_t* cache,
+                       int threads, mail_verify_stats_t* stats) {
+    size_t hits = cache ? cache->hits : 0;
+    verify_job_t job = { list, keys, cache };
+    thread_pool_job_t pool_job = { verify_thread_init, verify_one, verify_thread_done };
+    thread_pool_run(list->count, threads, &pool_job, &job);
+
+    if (stats) {
+        memset(stats, 0, sizeof(*stats));
+        stats->cached = cache ? cache->hits - hits : 0;
+        for (int i = 0; i < list->count; i++) {
+            switch (list->items[i].verify_status) {
+            case MAIL_SIG_VERIFIED: stats->verified++; break;
+            case MAIL_SIG_FAILED: stats->failed++; break;
+            case MAIL_SIG_INVALID: stats->invalid++; break;
+            case MAIL_SIG_UNSIGNED: stats->unsigned_count++; break;
+            case MAIL_SIG_NO_KEY: stats->no_key++; break;
+            default: stats->unchecked++; break;
+            }
+        }
+    }
+}
+
+static verify_key_t* new_verify_key(EVP_PKEY* pkey, int with_fingerprint) {
+    verify_key_t* key = calloc(1, sizeof(verify_key_t));
+    if (!key) return NULL;
+    key->pkey = pkey;
+    key->has_fingerprint = with_fingerprint && verify_cache_fingerprint(pkey, key->fingerprint);
+    return key;
+}
+
+static void free_verify_key(void* value) {
+    verify_key_t* key = (verify_key_t*)value;
+    if (!key) return;
+    EVP_PKEY_free(key->pkey);
+    free(key);
+}
+
+int verify_mail_list(mail_list_t* list, const key_directory_t* key_dir, const char* cache_file,
+                     int threads, mail_verify_stats_t* stats) {
+    verify_key_t** keys = calloc(list->count ? list->count : 1, sizeof(verify_key_t*));
+    hashmap_t* loaded = hashmap_new(64);  // 公钥文件 -> verify_key_t，NULL表示加载失败
+    if (!keys || !loaded) {
+        free(keys);
+        if (loaded) hashmap_free(loaded, NULL);
+        return 0;
+    }
+
+    // 缓存打不开时照常逐封验签
+    verify_cache_t* cache = cache_file ? verify_cache_open(cache_file) : NULL;
+
+    // 验签前按发件人一次查好公钥，每个公钥文件只加载、计算指纹一次
+    for (int i = 0; i < list->count; i++) {
+        const mail_item_t* item = &list->items[i];
+        if (!item->has_signature || !item->complete) continue;
+
+        const char* file = key_directory_file(key_dir, item->from, item->from ? strlen(item->from) : 0);
+        if (!file) continue;
+        if (!hashmap_contains(loaded, file)) {
+            EVP_PKEY* pkey = keyring_get(keyring_default(), file, KEY_PUBLIC);
+            verify_key_t* key = pkey ? new_verify_key(pkey, cache != NULL) : NULL;
+            if (pkey && !key) EVP_PKEY_free(pkey);
+            hashmap_put(loaded, file, key);
+        }
+        keys[i] = hashmap_get(loaded, file);
+    }
+
+    run_verify(list, keys, cache, threads, stats);
+
+    verify_cache_close(cache);
+    hashmap_free(loaded, free_verify_key);
+    free(keys);
+    return 1;
+}
+
+void verify_mail_list_key(mail_list_t* list, EVP_PKEY* pkey, verify_cache_t* cache,
+                          int threads, mail_verify_stats_t* stats) {
+    verify_key_t key;
+    key.pkey = pkey;
+    key.has_fingerprint = cache && verify_cache_fingerprint(pkey, key.fingerprint);
+
+    verify_key_t** keys = malloc((list->count ? list->count : 1) * sizeof(verify_key_t*));
+    if (!keys) return;
+    for (int i = 0; i < list->count; i++) keys[i] = &key;
+
+    run_verify(list, keys, cache, threads, stats);
+    free(keys);
+}
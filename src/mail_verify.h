@@ -0,0 +1,40 @@
+#ifndef MAIL_VERIFY_H
+#define MAIL_VERIFY_H
+
+#include <stddef.h>
+#include <openssl/evp.h>
+#include "mail.h"
+#include "verify_cache.h"
+#include "key_directory.h"
+
+// 批量验签统计
+typedef struct {
+    size_t verified;
+    size_t failed;
+    size_t invalid;
+    size_t unsigned_count;
+    size_t unchecked;  // 只有邮件头，未验签
+    size_t no_key;     // 找不到发件人公钥
+    size_t cached;     // 结果直接取自验签缓存的邮件数
+} mail_verify_stats_t;
+
+// 验证一封邮件的签名，返回MAIL_SIG_*。signature为base64文本(可含折行)，
+// alg为签名附件的算法标记，没有标记时按旧的RSA双重摘要格式验证。
+// md为调用者复用的上下文，为NULL时临时创建
+int mail_verify_signature(EVP_MD_CTX* md, EVP_PKEY* pkey,
+                          const char* body, size_t body_len,
+                          const char* signature, size_t sig_len,
+                          const char* alg, size_t alg_len);
+
+// 用线程池验证列表中所有完整下载的邮件，签名通过后再核对附件摘要，结果写入各项的verify_status。
+// 每封邮件按From在公钥目录中查找发件人公钥，每个公钥只加载一次并在线程间只读共享；
+// 每个线程一个EVP_MD_CTX，threads<=0时使用CPU数。
+// cache_file不为NULL时先查验签缓存，未变化的邮件不再做公钥运算。内存不足返回0
+int verify_mail_list(mail_list_t* list, const key_directory_t* key_dir, const char* cache_file,
+                     int threads, mail_verify_stats_t* stats);
+
+// 所有邮件使用同一个已加载的公钥，cache为已打开的缓存(可以为NULL)
+void verify_mail_list_key(mail_list_t* list, EVP_PKEY* pkey, verify_cache_t* cache,
+                          int threads, mail_verify_stats_t* stats);
+
+#endif // MAIL_VERIFY_H
@@ -0,0 +1,225 @@
+#include "mail_view.h"
+#include "mime_parser.h"
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+// 解析时的邮件头扫描上下文
+typedef struct {
+    const mail_view_t* view;
+    mail_view_t* out;        // 解析时填写的视图，只取附件时为NULL
+    char boundary[128];
+    mime_part_kind_t part_kind;
+    char filename[128];      // 当前附件的文件名
+    arena_t* arena;          // 只取附件时分配附件链表
+    mail_attachment_t* attachments;
+    int error;
+} view_scan_ctx_t;
+
+typedef void (*view_part_fn)(view_scan_ctx_t* ctx, const char* data, size_t len);
+
+static mail_span_t make_span(const mail_view_t* view, const char* data, size_t len) {
+    mail_span_t span = { (size_t)(data - view->raw), len };
+    return span;
+}
+
+static void scan_mail_header(const char* name, size_t name_len,
+                             const char* value, size_t value_len, void* arg) {
+    view_scan_ctx_t* ctx = (view_scan_ctx_t*)arg;
+    mail_view_t* view = ctx->out;
+    mail_span_t* field = NULL;
+
+    if (mime_name_is(name, name_len, "Content-Type")) {
+        char* content_type = mime_unfold(value, value_len);
+        if (content_type && strncasecmp(content_type, "multipart/", 10) == 0) {
+            mime_get_param(content_type, "boundary", ctx->boundary, sizeof(ctx->boundary));
+        }
+        free(content_type);
+    } else if (!view) {
+        return;  // 只取附件时不需要其他字段
+    } else if (mime_name_is(name, name_len, "Message-ID")) field = &view->message_id;
+    else if (mime_name_is(name, name_len, "From")) field = &view->from;
+    else if (mime_name_is(name, name_len, "Date")) field = &view->date;
+    else if (mime_name_is(name, name_len, "Subject")) field = &view->subject;
+
+    if (field && field->len == 0) *field = make_span(ctx->view, value, value_len);
+}
+
+static void scan_part_header(const char* name, size_t name_len,
+                             const char* value, size_t value_len, void* arg) {
+    view_scan_ctx_t* ctx = (view_scan_ctx_t*)arg;
+    mime_part_kind_t kind = mime_classify_header(name, name_len, value, value_len);
+
+    if (ctx->out && ctx->out->signature_alg.len == 0 && mime_name_is(name, name_len, SIGNATURE_ALG_HEADER)) {
+        ctx->out->signature_alg = make_span(ctx->view, value, value_len);
+    }
+
+    if (kind == MIME_PART_ATTACHMENT && !ctx->out) {
+        char* disposition = mime_unfold(value, value_len);
+        if (!disposition || !mime_get_param(disposition, "filename", ctx->filename, sizeof(ctx->filename))) {
+            ctx->filename[0] = '\0';
+        }
+        free(disposition);
+    }
+
+    if (kind == MIME_PART_SIGNATURE || kind == MIME_PART_ATTACHMENT || ctx->part_kind == MIME_PART_OTHER) {
+        ctx->part_kind = kind;
+    }
+}
+
+static void set_part(view_scan_ctx_t* ctx, const char* data, size_t len) {
+    mail_view_t* view = ctx->out;
+    mail_span_t span = make_span(view, data, len);
+
+    if (ctx->part_kind == MIME_PART_TEXT && view->body.len == 0) {
+        mail_span_trim_body(view->raw, &span);
+        view->body = span;
+    } else if (ctx->part_kind == MIME_PART_SIGNATURE) {
+        mail_span_trim_signature(view->raw, &span);
+        view->signature = span;
+        view->has_signature = 1;
+    }
+}
+
+// 解码附件并计算摘要，接到附件链表末尾
+static void add_attachment(view_scan_ctx_t* ctx, const char* data, size_t len) {
+    if (ctx->part_kind != MIME_PART_ATTACHMENT || ctx->error) return;
+
+    mime_digest_t state;
+    memset(&state, 0, sizeof(state));
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int digest_len = 0;
+    if (!mime_digest_init(&state) || !mime_digest_update(&state, data, len)) {
+        ctx->error = 1;
+    } else if (!mime_digest_final(&state, digest, &digest_len)) {
+        digest_len = 0;
+    }
+    mime_digest_free(&state);
+
+    if (!ctx->error && !mail_attachment_append(ctx->arena, &ctx->attachments, ctx->filename,
+                                               strlen(ctx->filename), digest, digest_len)) {
+        ctx->error = 1;
+    }
+    ctx->filename[0] = '\0';
+}
+
+// 单遍扫描邮件头，再按分隔线逐个切分子部分，每个子部分的类型确定后交给fn
+static void scan_parts(view_scan_ctx_t* ctx, view_part_fn fn) {
+    const char* raw = ctx->view->raw;
+    const char* end = raw + ctx->view->raw_len;
+    const char* body = raw + mime_header_scan(raw, end - raw, scan_mail_header, ctx);
+
+    if (!ctx->boundary[0]) {
+        ctx->part_kind = MIME_PART_TEXT;
+        fn(ctx, body, end - body);
+        return;
+    }
+
+    int closing = 0;
+    size_t next = 0;
+    mime_find_boundary(body, end - body, ctx->boundary, &closing, &next);
+    const char* part = body + next;
+
+    while (part < end && !closing) {
+        size_t part_len = mime_find_boundary(part, end - part, ctx->boundary, &closing, &next);
+
+        ctx->part_kind = MIME_PART_OTHER;
+        size_t content = mime_header_scan(part, part_len, scan_part_header, ctx);
+        fn(ctx, part + content, part_len - content);
+
+        part += next;
+    }
+}
+
+void mail_view_parse(mail_view_t* view, const char* raw, size_t len) {
+    memset(view, 0, sizeof(*view));
+    view->raw = raw;
+    view->raw_len = len;
+
+    view_scan_ctx_t ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.view = view;
+    ctx.out = view;
+    scan_parts(&ctx, set_part);
+}
+
+int mail_attachment_append(arena_t* arena, mail_attachment_t** list, const char* name, size_t name_len,
+                           const unsigned char* digest, size_t digest_len) {
+    mail_attachment_t* attachment = arena_alloc(arena, sizeof(mail_attachment_t));
+    if (!attachment || !(attachment->name = arena_strndup(arena, name, name_len))) return 0;
+
+    attachment->has_digest = digest_len == MIME_DIGEST_LEN;
+    if (attachment->has_digest) memcpy(attachment->digest, digest, MIME_DIGEST_LEN);
+    attachment->next = NULL;
+
+    while (*list) list = &(*list)->next;
+    *list = attachment;
+    return 1;
+}
+
+int mail_view_attachments(const mail_view_t* view, arena_t* arena, mail_attachment_t** attachments) {
+    view_scan_ctx_t ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.view = view;
+    ctx.arena = arena;
+    scan_parts(&ctx, add_attachment);
+
+    *attachments = ctx.attachments;
+    return !ctx.error;
+}
+
+void mail_span_trim_body(const char* raw, mail_span_t* span) {
+    const char* start = raw + span->off;
+    const char* end = start + span->len;
+
+    while (start < end && (*start == '\n' || *start == '\r' || *start == '-')) {
+        start++;
+    }
+    while (end > start && (end[-1] == '\n' || end[-1] == '\r' || end[-1] == '-')) {
+        end--;
+    }
+
+    span->off = start - raw;
+    span->len = end - start;
+}
+
+void mail_span_trim_signature(const char* raw, mail_span_t* span) {
+    const char* data = raw + span->off;
+    while (span->len > 0 && (data[span->len - 1] == '\n' || data[span->len - 1] == '\r'
+                             || data[span->len - 1] == '-' || data[span->len - 1] == ' ')) {
+        span->len--;
+    }
+}
+
+char* mail_view_dup(const mail_view_t* view, mail_span_t span) {
+    return mime_unfold(mail_span_ptr(view, span), span.len);
+}
+
+// 复制一个字段，不存在时用占位内容
+static char* materialize_field(const mail_view_t* view, arena_t* arena,
+                               mail_span_t span, const char* fallback) {
+    if (span.len == 0) return arena_strdup(arena, fallback);
+
+    char* copy = arena_alloc(arena, span.len + 1);
+    if (copy) mime_unfold_to(copy, mail_span_ptr(view, span), span.len);
+    return copy;
+}
+
+void mail_view_materialize(const mail_view_t* view, arena_t* arena, mail_item_t* item) {
+    item->message_id = materialize_field(view, arena, view->message_id, "No Message-ID");
+    item->from = materialize_field(view, arena, view->from, "No From");
+    item->date = materialize_field(view, arena, view->date, "No Date");
+    item->subject = materialize_field(view, arena, view->subject, "No Subject");
+    item->body = arena_strndup(arena, mail_span_ptr(view, view->body), view->body.len);
+
+    item->has_signature = view->has_signature;
+    if (view->has_signature) {
+        item->signature_file = arena_strndup(arena, mail_span_ptr(view, view->signature), view->signature.len);
+        item->signature_file_len = view->signature.len;
+    }
+    if (view->signature_alg.len) {
+        item->signature_alg = materialize_field(view, arena, view->signature_alg, "");
+    }
+    // 附件只保留摘要，分配失败时少记的附件会让验签失败而不是通过
+    mail_view_attachments(view, arena, &item->attachments);
+}
@@ -0,0 +1,56 @@
+#ifndef MAIL_VIEW_H
+#define MAIL_VIEW_H
+
+#include <stddef.h>
+#include "mail.h"
+#include "arena.h"
+
+// 原始邮件中的一段，len为0表示不存在
+typedef struct {
+    size_t off;
+    size_t len;
+} mail_span_t;
+
+// 零拷贝邮件视图：所有字段都是指向原始邮件的span，不复制任何内容。
+// raw可以是保留的接收缓冲区或本地邮件库的mmap映射，视图使用期间须保持有效
+typedef struct {
+    const char* raw;
+    size_t raw_len;
+    mail_span_t message_id;  // 邮件头字段为原始值，可能含折行
+    mail_span_t from;
+    mail_span_t date;
+    mail_span_t subject;
+    mail_span_t body;        // 已去掉首尾空行和分隔线
+    mail_span_t signature;   // 签名附件的base64文本
+    mail_span_t signature_alg;  // 签名附件的X-Signature-Alg，旧格式为空
+    int has_signature;
+} mail_view_t;
+
+// 解析原始邮件，只记录各字段的位置
+void mail_view_parse(mail_view_t* view, const char* raw, size_t len);
+
+// 取span指向的数据
+static inline const char* mail_span_ptr(const mail_view_t* view, mail_span_t span) {
+    return view->raw + span.off;
+}
+
+// 去除正文首尾的空行和分隔线横杠
+void mail_span_trim_body(const char* raw, mail_span_t* span);
+
+// 去除签名末尾的空行、空格和横杠
+void mail_span_trim_signature(const char* raw, mail_span_t* span);
+
+// 按需生成以'\0'结尾的副本(展开折行)，由调用者free
+char* mail_view_dup(const mail_view_t* view, mail_span_t span);
+
+// 把一个附件接到list末尾，digest_len不是MIME_DIGEST_LEN时记为没有摘要。内存不足返回0
+int mail_attachment_append(arena_t* arena, mail_attachment_t** list, const char* name, size_t name_len,
+                           const unsigned char* digest, size_t digest_len);
+
+// 逐个解码签名以外的附件并计算摘要，按出现顺序得到附件链表(分配在arena中)，内存不足返回0
+int mail_view_attachments(const mail_view_t* view, arena_t* arena, mail_attachment_t** attachments);
+
+// 把视图复制成邮件项(含附件摘要)，字符串分配在arena中
+void mail_view_materialize(const mail_view_t* view, arena_t* arena, mail_item_t* item);
+
+#endif // MAIL_VIEW_H
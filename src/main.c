@@ -5,6 +5,8 @@
 #include "mail.h"
 #include "base64.h"
 #include "gui.h"
+#include "key_directory.h"
+#include "mail_spool.h"
 
 #define MAX_MESSAGE_LENGTH 1024
 #define CONFIG_FILE "mail.conf"
@@ -14,12 +16,18 @@
 void print_usage() {
     printf("使用方法:\n");
     printf("1. 图形界面模式: ./crymail\n");
-    printf("2. 生成密钥对: ./crymail -g\n");
+    printf("2. 生成密钥对: ./crymail -g [rsa|ed25519|p256]  (默认rsa)\n");
     printf("3. 签名消息: ./crymail -s <消息>\n");
     printf("4. 验证签名: ./crymail -v <消息> <签名文件>\n");
     printf("5. 配置邮件: ./crymail -c\n");
-    printf("6. 发送签名邮件: ./crymail -m <收件人> <主题> <消息>\n");
-    printf("7. 接收邮件: ./crymail -l\n");
+    printf("6. 发送签名邮件: ./crymail -m <收件人> <主题> <消息> [--cc <地址>] [--bcc <地址>] [附件...]\n");
+    printf("7. 接收邮件: ./crymail -l [--full]  (默认只下载邮件头, --full 下载完整邮件)\n");
+    printf("8. 离线查看本地邮件: ./crymail -o\n");
+    printf("9. 批量校验本地邮件签名: ./crymail -a [线程数]\n");
+    printf("10. 导入发件人公钥: ./crymail -k <发件人地址> <公钥文件>\n");
+    printf("11. 批量发送签名邮件: ./crymail -b <任务文件> [签名线程数] [连接数]\n");
+    printf("12. 签名邮件放入发件队列: ./crymail -q <收件人> <主题> <消息> [--cc <地址>] [--bcc <地址>] [附件...]\n");
+    printf("13. 投递发件队列: ./crymail --daemon [连接数]\n");
 }
 
 // 配置邮件设置
@@ -50,6 +58,12 @@ int configure_mail() {
     fgets(buffer, sizeof(buffer), stdin);
     config.use_ssl = atoi(buffer);
 
+    // 这里不询问发送引擎，沿用配置文件中原有的smtp_engine
+    mail_config_t existing;
+    memset(&existing, 0, sizeof(existing));
+    load_mail_config(&existing, CONFIG_FILE);
+    config.smtp_native = existing.smtp_native;
+
     printf("请输入pop3服务器地址：");
     fgets(buffer, sizeof(buffer), stdin);
     config.pop3_server = strdup(buffer);
@@ -89,8 +103,17 @@ int main(int argc, char *argv[]) {
     }
 
     if (strcmp(argv[1], "-g") == 0) {
-        // 生成密钥对
-        if (generate_key_pair("public.pem", "private.pem")) {
+        // 生成密钥对，可选算法
+        sig_key_type_t type = SIG_KEY_RSA;
+        if (argc > 2) {
+            if (strcmp(argv[2], "ed25519") == 0) type = SIG_KEY_ED25519;
+            else if (strcmp(argv[2], "p256") == 0) type = SIG_KEY_ECDSA_P256;
+            else if (strcmp(argv[2], "rsa") != 0) {
+                printf("错误：不支持的密钥算法 %s\n", argv[2]);
+                return 1;
+            }
+        }
+        if (generate_key_pair_ex("public.pem", "private.pem", type)) {
             printf("密钥对生成成功！\n");
         } else {
             printf("密钥对生成失败！\n");
@@ -160,7 +183,8 @@ int main(int argc, char *argv[]) {
             return 1;
         }
     }
-    else if (strcmp(argv[1], "-m") == 0) {
+    else if (strcmp(argv[1], "-m") == 0 || strcmp(argv[1], "-q") == 0) {
+        int queue_only = strcmp(argv[1], "-q") == 0;
         if (argc < 5) {
             printf("错误：请提供收件人、主题和消息\n");
             return 1;
@@ -176,43 +200,106 @@ int main(int argc, char *argv[]) {
             return 1;
         }
 
+        // 其余参数为--cc/--bcc地址列表和附件，附件留在argv中原位前移，
+        // 附件摘要附在正文后一起签名
+        const char* cc = NULL;
+        const char* bcc = NULL;
+        int attachment_count = 0;
+        for (int i = 5; i < argc; i++) {
+            if (strcmp(argv[i], "--cc") == 0 && i + 1 < argc) cc = argv[++i];
+            else if (strcmp(argv[i], "--bcc") == 0 && i + 1 < argc) bcc = argv[++i];
+            else argv[5 + attachment_count++] = argv[i];
+        }
+        const char* const* attachments = (const char* const*)(argv + 5);
+        char* body = mail_signed_body(argv[4], attachments, attachment_count);
+        if (!body) {
+            printf("无法读取附件！\n");
+            return 1;
+        }
+
         // 签名消息
         unsigned int sig_len;
-        unsigned char* signature = sign_message(argv[4], "private.pem", &sig_len);
+        unsigned char* signature = sign_message(body, "private.pem", &sig_len);
         if (!signature) {
             printf("消息签名失败！\n");
+            free(body);
             return 1;
         }
 
-        // 保存签名到临时文件
-        FILE* fp = fopen("temp_signature.bin", "wb");
-        if (fp) {
-            fwrite(signature, 1, sig_len, fp);
-            fclose(fp);
-        }
-        free(signature);
-
         // 准备邮件内容
         mail_content_t content = {
             .from = config.username,
             .to = argv[2],
+            .cc = cc,
+            .bcc = bcc,
             .subject = argv[3],
-            .body = argv[4],
-            .signature_file = "temp_signature.bin"
+            .body = body,
+            .signature = signature,
+            .signature_len = sig_len,
+            .signature_alg = sig_alg_name_file("private.pem", 1),
+            .attachments = attachments,
+            .attachment_count = attachment_count
         };
         
-        // 发送邮件
-        if (send_signed_mail(&config, &content)) {
+        // 直接发送和转入队列后的重试使用同一个Message-ID
+        char message_id[MAIL_MESSAGE_ID_MAX];
+        if (mail_new_message_id(message_id, sizeof(message_id))) content.message_id = message_id;
+
+        // -q只写入发件队列；-m直接发送，失败时转入队列由投递进程重试，
+        // 部分收件人已经收到时只把其余的收件人放入队列
+        char* retry = NULL;
+        int sent = !queue_only && send_signed_mail_ex(&config, &content, &retry);
+        int queued = 0;
+        if (!sent && (!retry || *retry)) {
+            content.envelope = retry;
+            mail_spool_t* spool = mail_spool_open(MAIL_SPOOL_FILE, MAIL_SPOOL_INDEX_FILE);
+            queued = spool && mail_spool_enqueue(spool, &content);
+            mail_spool_close(spool);
+        }
+        int partial = retry != NULL;
+        free(retry);
+        free(signature);
+        free(body);
+        if (sent) {
             printf("签名邮件发送成功！\n");
+        } else if (queued) {
+            printf("%s签名邮件已放入发件队列，由 --daemon 投递\n",
+                   queue_only ? "" : partial ? "部分收件人发送失败，其余收件人的" : "发送失败，");
         } else {
             printf("签名邮件发送失败！\n");
             return 1;
         }
 
         // 清理
-        remove("temp_signature.bin");
         mail_cleanup();
     }
+    else if (strcmp(argv[1], "-b") == 0 && argc > 2) {
+        mail_init();
+
+        mail_config_t config;
+        if (!load_mail_config(&config, CONFIG_FILE)) {
+            printf("无法加载邮件配置，请先运行 -c 选项配置邮件\n");
+            return 1;
+        }
+        int threads = argc > 3 ? atoi(argv[3]) : 0;
+        int connections = argc > 4 ? atoi(argv[4]) : 1;
+        int ok = send_bulk_mail(&config, argv[2], threads, connections);
+        mail_cleanup();
+        if (!ok) return 1;
+    }
+    else if (strcmp(argv[1], "--daemon") == 0) {
+        mail_init();
+
+        mail_config_t config;
+        if (!load_mail_config(&config, CONFIG_FILE)) {
+            printf("无法加载邮件配置，请先运行 -c 选项配置邮件\n");
+            return 1;
+        }
+        int connections = argc > 2 ? atoi(argv[2]) : 1;
+        int ok = run_spool_daemon(&config, connections);
+        mail_cleanup();
+        if (!ok) return 1;
+    }
     else if(strcmp(argv[1],"-l")==0){
          mail_init();
 
@@ -224,16 +311,41 @@ int main(int argc, char *argv[]) {
             printf("无法加载邮件配置，请先运行 -c 选项配置邮件\n");
             return 1;
         }
-        mail_list_t* list = receive_mail_list(&config);
+        int mode = (argc > 2 && strcmp(argv[2], "--full") == 0) ? MAIL_LIST_FULL : MAIL_LIST_HEADERS;
+        mail_list_t* list = receive_mail_list_ex(&config, mode);
+        if (!list) return 1;
 
         if (list->items == NULL && list->count > 0) {
             printf("邮件列表项数据为空\n");
-            free(list);
+            free_mail_list(list);
             return 1;
         }
 
+        free_mail_list(list);
         return 1;
     }
+    else if (strcmp(argv[1], "-o") == 0) {
+        mail_init();
+
+        // 列表完全离线，配置只在需要补全邮件时使用
+        mail_config_t config;
+        int has_config = load_mail_config(&config, CONFIG_FILE);
+        int ok = list_local_mail(has_config ? &config : NULL);
+        mail_cleanup();
+        if (!ok) return 1;
+    }
+    else if (strcmp(argv[1], "-a") == 0) {
+        int threads = argc > 2 ? atoi(argv[2]) : 0;
+        if (!audit_local_mail(threads)) return 1;
+    }
+    else if (strcmp(argv[1], "-k") == 0 && argc > 3) {
+        key_directory_t* keys = key_directory_default();
+        if (!keys || !key_directory_add(keys, argv[2], argv[3])) {
+            printf("导入公钥失败，请检查发件人地址和公钥文件\n");
+            return 1;
+        }
+        printf("已导入%s的公钥到%s目录\n", argv[2], KEY_DIR);
+    }
     else {
         print_usage();
         return 1;
@@ -0,0 +1,226 @@
+#include "mime_builder.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define BUILDER_ARENA_BLOCK 4096
+#define INITIAL_SEGMENTS 16
+#define ENCODE_CHUNK (57 * 1024)  // 每次编码的附件字节数，正好是1024行
+
+mime_builder_t* mime_builder_new(void) {
+    mime_builder_t* builder = calloc(1, sizeof(mime_builder_t));
+    if (!builder) return NULL;
+
+    builder->fd = -1;
+    builder->arena = arena_new(BUILDER_ARENA_BLOCK);
+    if (!builder->arena) {
+        free(builder);
+        return NULL;
+    }
+    return builder;
+}
+
+static int push_segment(mime_builder_t* builder, const char* data, size_t len, int encode, size_t size,
+                        const unsigned char* digest) {
+    if (builder->count == builder->cap) {
+        size_t cap = builder->cap ? builder->cap * 2 : INITIAL_SEGMENTS;
+        mime_segment_t* segments = realloc(builder->segments, cap * sizeof(mime_segment_t));
+        if (!segments) return 0;
+        builder->segments = segments;
+        builder->cap = cap;
+    }
+
+    builder->segments[builder->count].data = data;
+    builder->segments[builder->count].len = len;
+    builder->segments[builder->count].encode = encode;
+    builder->segments[builder->count].digest = digest;
+    builder->count++;
+    builder->size += size;
+    return 1;
+}
+
+int mime_builder_add(mime_builder_t* builder, const char* data, size_t len) {
+    return len == 0 || push_segment(builder, data, len, 0, len, NULL);
+}
+
+// 按76列折行编码后的长度，最后一行后面不加换行
+static size_t encoded_size(size_t len) {
+    size_t chars = (len + 2) / 3 * 4;
+    return chars ? chars + (chars - 1) / BASE64_LINE_MAX * 2 : 0;
+}
+
+// 空文件不需要读，直接核对空输入的摘要
+static int empty_digest_matches(const unsigned char* digest) {
+    unsigned char empty[EVP_MAX_MD_SIZE];
+    unsigned int len = 0;
+    return EVP_Digest("", 0, empty, &len, EVP_sha256(), NULL)
+        && len == MIME_DIGEST_LEN && memcmp(empty, digest, MIME_DIGEST_LEN) == 0;
+}
+
+int mime_builder_add_file(mime_builder_t* builder, const char* path, const unsigned char* digest) {
+    // 先确认文件存在并记下大小，打开和读取留到发送时
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+
+    struct stat st;
+    int ok = fstat(fd, &st) == 0 && S_ISREG(st.st_mode);
+    close(fd);
+    if (!ok) return 0;
+    if (st.st_size == 0) return !digest || empty_digest_matches(digest);
+
+    // 摘要在发送时对实际读出、编码的字节计算，和发出的内容一致
+    unsigned char* expected = NULL;
+    if (digest) {
+        expected = arena_alloc(builder->arena, MIME_DIGEST_LEN);
+        if (!expected) return 0;
+        memcpy(expected, digest, MIME_DIGEST_LEN);
+    }
+    size_t path_len = strlen(path) + 1;
+    char* saved = arena_alloc(builder->arena, path_len);
+    if (!saved) return 0;
+    memcpy(saved, path, path_len);
+
+    return push_segment(builder, saved, st.st_size, 1, encoded_size(st.st_size), expected);
+}
+
+static void close_input(mime_builder_t* builder) {
+    if (builder->fd >= 0) close(builder->fd);
+    builder->fd = -1;
+}
+
+// 从附件的offset处读满n字节，文件变短或读取出错返回0
+static int read_input(int fd, unsigned char* out, size_t n, size_t offset) {
+    while (n > 0) {
+        ssize_t got = pread(fd, out, n, offset);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) return 0;
+        out += got;
+        n -= got;
+        offset += got;
+    }
+    return 1;
+}
+
+// 读出并编码附件的下一块
+static int encode_next_chunk(mime_builder_t* builder, const mime_segment_t* segment) {
+    if (!builder->chunk) {
+        builder->chunk = malloc(base64_encoded_max(ENCODE_CHUNK, BASE64_LINE_MAX) + 8);
+        builder->input = malloc(ENCODE_CHUNK);
+        if (!builder->chunk || !builder->input) return 0;
+    }
+    if (segment->digest && !builder->hash && !(builder->hash = EVP_MD_CTX_new())) return 0;
+    if (builder->offset == 0) {
+        close_input(builder);
+        builder->fd = open(segment->data, O_RDONLY);
+        if (builder->fd < 0) return 0;
+        posix_fadvise(builder->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+        base64_encoder_init(&builder->encoder, BASE64_LINE_MAX);
+        if (segment->digest && !EVP_DigestInit_ex(builder->hash, EVP_sha256(), NULL)) return 0;
+    }
+
+    size_t n = segment->len - builder->offset;
+    if (n > ENCODE_CHUNK) n = ENCODE_CHUNK;
+    if (!read_input(builder->fd, builder->input, n, builder->offset)) return 0;
+    if (segment->digest && !EVP_DigestUpdate(builder->hash, builder->input, n)) return 0;
+
+    builder->chunk_len = base64_encode_update(&builder->encoder, builder->input, n, builder->chunk);
+    builder->offset += n;
+    if (builder->offset == segment->len) {
+        close_input(builder);
+        // 最后一块在摘要核对通过之后才交出去，文件被改过时邮件在结尾之前中止
+        if (segment->digest) {
+            unsigned char digest[EVP_MAX_MD_SIZE];
+            unsigned int digest_len = 0;
+            if (!EVP_DigestFinal_ex(builder->hash, digest, &digest_len)
+                || digest_len != MIME_DIGEST_LEN || memcmp(digest, segment->digest, MIME_DIGEST_LEN) != 0) {
+                return 0;
+            }
+        }
+        builder->chunk_len += base64_encode_final(&builder->encoder, builder->chunk + builder->chunk_len);
+    }
+    builder->chunk_off = 0;
+    return 1;
+}
+
+int mime_builder_printf(mime_builder_t* builder, const char* fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(NULL, 0, fmt, args);
+    va_end(args);
+    if (len < 0) return 0;
+
+    char* text = arena_alloc(builder->arena, len + 1);
+    if (!text) return 0;
+
+    va_start(args, fmt);
+    vsnprintf(text, len + 1, fmt, args);
+    va_end(args);
+    return mime_builder_add(builder, text, len);
+}
+
+size_t mime_builder_read(mime_builder_t* builder, char* out, size_t len) {
+    size_t copied = 0;
+
+    while (copied < len && builder->current < builder->count && !builder->error) {
+        const mime_segment_t* segment = &builder->segments[builder->current];
+
+        if (segment->encode) {
+            if (builder->chunk_off == builder->chunk_len) {
+                if (builder->offset == segment->len) {
+                    builder->current++;
+                    builder->offset = 0;
+                    builder->chunk_len = builder->chunk_off = 0;
+                    continue;
+                }
+                if (!encode_next_chunk(builder, segment)) {
+                    builder->error = 1;
+                    break;
+                }
+            }
+            size_t n = builder->chunk_len - builder->chunk_off;
+            if (n > len - copied) n = len - copied;
+            memcpy(out + copied, builder->chunk + builder->chunk_off, n);
+            builder->chunk_off += n;
+            copied += n;
+            continue;
+        }
+
+        size_t n = segment->len - builder->offset;
+        if (n > len - copied) n = len - copied;
+
+        memcpy(out + copied, segment->data + builder->offset, n);
+        copied += n;
+        builder->offset += n;
+        if (builder->offset == segment->len) {
+            builder->current++;
+            builder->offset = 0;
+        }
+    }
+    return copied;
+}
+
+void mime_builder_rewind(mime_builder_t* builder) {
+    builder->current = 0;
+    builder->offset = 0;
+    builder->chunk_len = 0;
+    builder->chunk_off = 0;
+    builder->error = 0;
+    close_input(builder);
+}
+
+void mime_builder_free(mime_builder_t* builder) {
+    if (!builder) return;
+
+    close_input(builder);
+    arena_free(builder->arena);
+    EVP_MD_CTX_free(builder->hash);
+    free(builder->chunk);
+    free(builder->input);
+    free(builder->segments);
+    free(builder);
+}
@@ -0,0 +1,64 @@
+#ifndef MIME_BUILDER_H
+#define MIME_BUILDER_H
+
+#include <stddef.h>
+#include <openssl/evp.h>
+#include "arena.h"
+#include "base64.h"
+
+#define MIME_DIGEST_LEN 32  // 附件摘要(SHA-256)的字节数
+
+// 一段邮件数据，只引用不复制
+typedef struct {
+    const char* data;
+    size_t len;
+    int encode;  // 非0时data为附件路径，len为添加时的文件大小，读出时按76列base64编码
+    const unsigned char* digest;  // 附件应有的摘要，不为NULL时边编码边校验
+} mime_segment_t;
+
+// 分段构造的MIME邮件：邮件按顺序由若干片段组成，发送时依次读出，不拼接成整块。
+// 正文等大块数据只保存引用，必须在发送完成前保持有效；
+// 邮件头、分隔行等小片内容格式化到内存池中，占用内存只和这些内容成正比
+typedef struct {
+    arena_t* arena;
+    mime_segment_t* segments;
+    size_t count;
+    size_t cap;
+    size_t size;     // 邮件总字节数(附件按编码后计)
+    size_t current;  // 读游标：当前片段
+    size_t offset;   // 当前片段内已读出(附件为已编码)的字节数
+    // 附件边读边编码，只保留一块编码结果
+    base64_encoder_t encoder;
+    char* chunk;
+    size_t chunk_len;
+    size_t chunk_off;
+    unsigned char* input;  // 从附件读出的一块原始字节
+    int fd;                // 正在编码的附件，没有时为-1
+    EVP_MD_CTX* hash;  // 正在编码的附件的摘要
+    int error;         // 附件读取失败、变短或内容与摘要不符，已读出的邮件不完整，不能发出
+} mime_builder_t;
+
+mime_builder_t* mime_builder_new(void);
+
+// 追加对len字节数据的引用，成功返回1。需要和邮件同生命周期的小块数据可以分配在builder->arena中
+int mime_builder_add(mime_builder_t* builder, const char* data, size_t len);
+
+// 格式化一段文本到内存池并追加，成功返回1
+int mime_builder_printf(mime_builder_t* builder, const char* fmt, ...)
+    __attribute__((format(printf, 2, 3)));
+
+// 追加一个附件文件的base64编码内容。这里只记下路径和大小，发送时打开文件用pread分块读出编码，
+// 内存占用与文件大小无关；文件在发送前被截断时读不满，置error(映射读取会收到SIGBUS)。
+// 文件打不开返回0。digest不为NULL时对编码的字节计算SHA-256，与digest不符(文件在签名后被修改)则置error
+int mime_builder_add_file(mime_builder_t* builder, const char* path, const unsigned char* digest);
+
+// 从读游标处读出最多len字节，返回实际字节数，读完返回0。
+// 出错时也返回已读出的字节或0并置error，调用者必须检查error，不能把截断的邮件当成完整的发出
+size_t mime_builder_read(mime_builder_t* builder, char* out, size_t len);
+
+// 读游标回到开头，用于重新发送
+void mime_builder_rewind(mime_builder_t* builder);
+
+void mime_builder_free(mime_builder_t* builder);
+
+#endif // MIME_BUILDER_H
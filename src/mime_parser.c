@@ -0,0 +1,390 @@
+#include "mime_parser.h"
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+// 解析状态
+enum {
+    STATE_HEADERS,       // 邮件头
+    STATE_BODY,          // 非multipart邮件的正文
+    STATE_PREAMBLE,      // 第一个分隔线之前
+    STATE_PART_HEADERS,  // 子部分的头
+    STATE_PART_BODY,     // 子部分的内容
+    STATE_EPILOGUE,      // 结束分隔线之后
+};
+
+// 丢弃状态下只需保留足够判断分隔线的行首
+#define DISCARD_LINE_MAX 256
+
+// 附件摘要每次解码的base64字符数
+#define DIGEST_CHUNK 4096
+
+static int buf_append(mime_buf_t* buf, const char* data, size_t len) {
+    if (buf->len + len + 1 > buf->cap) {
+        size_t cap = buf->cap ? buf->cap : 256;
+        while (cap < buf->len + len + 1) cap *= 2;
+        char* ptr = realloc(buf->data, cap);
+        if (!ptr) return 0;
+        buf->data = ptr;
+        buf->cap = cap;
+    }
+    memcpy(buf->data + buf->len, data, len);
+    buf->len += len;
+    buf->data[buf->len] = '\0';
+    return 1;
+}
+
+static void buf_free(mime_buf_t* buf) {
+    free(buf->data);
+    buf->data = NULL;
+    buf->len = buf->cap = 0;
+}
+
+// 一个完整的头字段结束
+static void emit_header(mime_parser_t* parser) {
+    if (parser->header.len == 0) return;
+
+    char* name = parser->header.data;
+    char* colon = strchr(name, ':');
+    if (colon) {
+        *colon = '\0';
+        char* value = colon + 1;
+        while (*value == ' ' || *value == '\t') value++;
+        size_t value_len = parser->header.len - (value - name);
+
+        if (parser->state == STATE_HEADERS) {
+            if (strcasecmp(name, "Content-Type") == 0 && strncasecmp(value, "multipart/", 10) == 0) {
+                mime_get_param(value, "boundary", parser->boundary, sizeof(parser->boundary));
+            }
+            parser->callback(MIME_HEADER, name, value, value_len, parser->arg);
+        } else {
+            mime_part_kind_t kind = mime_classify_header(name, strlen(name), value, value_len);
+            if (kind == MIME_PART_ATTACHMENT) {
+                mime_get_param(value, "filename", parser->filename, sizeof(parser->filename));
+            }
+            if (kind == MIME_PART_SIGNATURE || kind == MIME_PART_ATTACHMENT
+                || (kind == MIME_PART_TEXT && !parser->text_done && parser->part_kind == MIME_PART_OTHER)) {
+                parser->part_kind = kind;
+            }
+            parser->callback(MIME_PART_HEADER, name, value, value_len, parser->arg);
+        }
+    }
+    parser->header.len = 0;
+}
+
+// 输出当前部分
+static void emit_part(mime_parser_t* parser) {
+    if (parser->part_kind == MIME_PART_TEXT) {
+        parser->text_done = 1;
+        parser->callback(MIME_TEXT, NULL, parser->part.data ? parser->part.data : "",
+                         parser->part.len, parser->arg);
+    } else if (parser->part_kind == MIME_PART_SIGNATURE) {
+        parser->callback(MIME_SIGNATURE, NULL, parser->part.data ? parser->part.data : "",
+                         parser->part.len, parser->arg);
+    } else if (parser->part_kind == MIME_PART_ATTACHMENT) {
+        unsigned char digest[EVP_MAX_MD_SIZE];
+        unsigned int digest_len = 0;
+        if (!mime_digest_final(&parser->digest, digest, &digest_len)) digest_len = 0;
+        parser->callback(MIME_ATTACHMENT, parser->filename, (const char*)digest, digest_len, parser->arg);
+    }
+    parser->part.len = 0;
+    parser->part_kind = MIME_PART_OTHER;
+    parser->filename[0] = '\0';
+}
+
+// 判断是否为分隔线，返回1为"--boundary"，2为结束分隔线"--boundary--"
+static int match_boundary(const mime_parser_t* parser, const char* line, size_t len) {
+    size_t blen = strlen(parser->boundary);
+    if (blen == 0 || len < blen + 2 || line[0] != '-' || line[1] != '-'
+        || memcmp(line + 2, parser->boundary, blen) != 0) {
+        return 0;
+    }
+    if (len >= blen + 4 && line[blen + 2] == '-' && line[blen + 3] == '-') return 2;
+    return 1;
+}
+
+// 处理一整行(已去掉行尾换行)
+static int process_line(mime_parser_t* parser, const char* line, size_t len) {
+    int boundary;
+
+    switch (parser->state) {
+    case STATE_HEADERS:
+    case STATE_PART_HEADERS:
+        if (len > 0 && (line[0] == ' ' || line[0] == '\t')) {
+            // 折行，拼到上一个头字段
+            return buf_append(&parser->header, line, len);
+        }
+        emit_header(parser);
+        if (len > 0) return buf_append(&parser->header, line, len);
+
+        // 空行：头结束
+        if (parser->state == STATE_PART_HEADERS) {
+            parser->state = STATE_PART_BODY;
+            // 附件内容不保留，逐行解码进摘要
+            if (parser->part_kind == MIME_PART_ATTACHMENT) return mime_digest_init(&parser->digest);
+        } else if (parser->boundary[0]) {
+            parser->state = STATE_PREAMBLE;
+        } else {
+            parser->state = STATE_BODY;
+            parser->part_kind = MIME_PART_TEXT;
+        }
+        return 1;
+
+    case STATE_BODY:
+        return buf_append(&parser->part, line, len) && buf_append(&parser->part, "\r\n", 2);
+
+    case STATE_PREAMBLE:
+    case STATE_PART_BODY:
+        boundary = parser->line_overflow ? 0 : match_boundary(parser, line, len);
+        if (boundary) {
+            if (parser->state == STATE_PART_BODY) emit_part(parser);
+            parser->state = boundary == 2 ? STATE_EPILOGUE : STATE_PART_HEADERS;
+            parser->closed = boundary == 2;
+            return 1;
+        }
+        if (parser->state == STATE_PART_BODY && parser->part_kind == MIME_PART_ATTACHMENT) {
+            return mime_digest_update(&parser->digest, line, len);
+        }
+        if (parser->state == STATE_PART_BODY && parser->part_kind != MIME_PART_OTHER) {
+            return buf_append(&parser->part, line, len) && buf_append(&parser->part, "\r\n", 2);
+        }
+        return 1;
+
+    default:
+        return 1;
+    }
+}
+
+// 当前状态下的内容是否会被丢弃
+static int discarding(const mime_parser_t* parser) {
+    return parser->state == STATE_PREAMBLE || parser->state == STATE_EPILOGUE
+        || (parser->state == STATE_PART_BODY && parser->part_kind == MIME_PART_OTHER);
+}
+
+void mime_parser_init(mime_parser_t* parser, mime_callback_t callback, void* arg) {
+    memset(parser, 0, sizeof(*parser));
+    parser->state = STATE_HEADERS;
+    parser->part_kind = MIME_PART_OTHER;
+    parser->callback = callback;
+    parser->arg = arg;
+}
+
+int mime_parser_feed(mime_parser_t* parser, const char* data, size_t len) {
+    while (len > 0) {
+        const char* newline = memchr(data, '\n', len);
+        size_t chunk = newline ? (size_t)(newline - data) : len;
+
+        if (discarding(parser) && parser->line.len + chunk > DISCARD_LINE_MAX) {
+            parser->line_overflow = 1;
+        } else if (!buf_append(&parser->line, data, chunk)) {
+            return 0;
+        }
+
+        if (!newline) break;
+
+        size_t line_len = parser->line.len;
+        if (line_len > 0 && parser->line.data[line_len - 1] == '\r') line_len--;
+        if (!process_line(parser, parser->line.data ? parser->line.data : "", line_len)) return 0;
+
+        parser->line.len = 0;
+        parser->line_overflow = 0;
+        data += chunk + 1;
+        len -= chunk + 1;
+    }
+    return 1;
+}
+
+int mime_parser_finish(mime_parser_t* parser) {
+    // 最后一行可能没有换行符
+    if (parser->line.len > 0 || parser->line_overflow) {
+        size_t line_len = parser->line.len;
+        if (line_len > 0 && parser->line.data[line_len - 1] == '\r') line_len--;
+        if (!process_line(parser, parser->line.data ? parser->line.data : "", line_len)) return 0;
+        parser->line.len = 0;
+    }
+
+    if (parser->state == STATE_HEADERS || parser->state == STATE_PART_HEADERS) {
+        emit_header(parser);
+    }
+    // TOP只取了部分正文，或者邮件缺少结束分隔线
+    if (parser->state == STATE_BODY || parser->state == STATE_PART_BODY) {
+        emit_part(parser);
+    }
+    parser->state = STATE_EPILOGUE;
+    return 1;
+}
+
+void mime_parser_free(mime_parser_t* parser) {
+    buf_free(&parser->line);
+    buf_free(&parser->header);
+    buf_free(&parser->part);
+    mime_digest_free(&parser->digest);
+}
+
+int mime_digest_init(mime_digest_t* digest) {
+    if (!digest->md && !(digest->md = EVP_MD_CTX_new())) return 0;
+    base64_decoder_init(&digest->decoder);
+    return EVP_DigestInit_ex(digest->md, EVP_sha256(), NULL);
+}
+
+int mime_digest_update(mime_digest_t* digest, const char* data, size_t len) {
+    unsigned char decoded[DIGEST_CHUNK / 4 * 3 + 6];
+
+    // 非法字符只记在解码器里，final时报告
+    while (len > 0 && !digest->decoder.error) {
+        size_t n = len < DIGEST_CHUNK ? len : DIGEST_CHUNK;
+        size_t decoded_len = 0;
+        base64_decode_update(&digest->decoder, data, n, decoded, &decoded_len);
+        if (!EVP_DigestUpdate(digest->md, decoded, decoded_len)) return 0;
+        data += n;
+        len -= n;
+    }
+    return 1;
+}
+
+int mime_digest_final(mime_digest_t* digest, unsigned char* out, unsigned int* out_len) {
+    return digest->md && EVP_DigestFinal_ex(digest->md, out, out_len) && base64_decode_final(&digest->decoder);
+}
+
+void mime_digest_free(mime_digest_t* digest) {
+    EVP_MD_CTX_free(digest->md);
+    digest->md = NULL;
+}
+
+// 支持带引号和不带引号的参数值
+int mime_get_param(const char* value, const char* name, char* out, size_t size) {
+    size_t name_len = strlen(name);
+    const char* p = value;
+
+    while ((p = strchr(p, ';')) != NULL) {
+        p++;
+        while (*p == ' ' || *p == '\t') p++;
+        if (strncasecmp(p, name, name_len) != 0 || p[name_len] != '=') continue;
+
+        p += name_len + 1;
+        const char* end;
+        if (*p == '"') {
+            end = strchr(++p, '"');
+            if (!end) end = p + strlen(p);
+        } else {
+            end = p + strcspn(p, "; \t");
+        }
+
+        size_t len = end - p;
+        if (len == 0 || len >= size) return 0;
+        memcpy(out, p, len);
+        out[len] = '\0';
+        return 1;
+    }
+    return 0;
+}
+
+int mime_name_is(const char* name, size_t name_len, const char* expected) {
+    return strlen(expected) == name_len && strncasecmp(name, expected, name_len) == 0;
+}
+
+size_t mime_unfold_to(char* out, const char* value, size_t len) {
+    size_t j = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (value[i] != '\r' && value[i] != '\n') out[j++] = value[i];
+    }
+    out[j] = '\0';
+    return j;
+}
+
+char* mime_unfold(const char* value, size_t len) {
+    char* out = malloc(len + 1);
+    if (!out) return NULL;
+
+    mime_unfold_to(out, value, len);
+    return out;
+}
+
+mime_part_kind_t mime_classify_header(const char* name, size_t name_len,
+                                      const char* value, size_t value_len) {
+    int is_type = mime_name_is(name, name_len, "Content-Type");
+    int is_disposition = mime_name_is(name, name_len, "Content-Disposition");
+    if (!is_type && !is_disposition) return MIME_PART_OTHER;
+
+    char* unfolded = mime_unfold(value, value_len);
+    if (!unfolded) return MIME_PART_OTHER;
+
+    mime_part_kind_t kind = MIME_PART_OTHER;
+    if (is_type && strncasecmp(unfolded, "text/plain", 10) == 0) {
+        kind = MIME_PART_TEXT;
+    } else if (is_disposition && strstr(unfolded, "filename=\"signature.bin\"")) {
+        kind = MIME_PART_SIGNATURE;
+    } else if (is_disposition && strstr(unfolded, "filename=")) {
+        kind = MIME_PART_ATTACHMENT;
+    }
+    free(unfolded);
+    return kind;
+}
+
+size_t mime_header_scan(const char* data, size_t len, mime_header_fn fn, void* arg) {
+    const char* name = NULL;
+    size_t name_len = 0, value_start = 0, value_end = 0;
+    size_t pos = 0;
+
+    while (pos < len) {
+        const char* newline = memchr(data + pos, '\n', len - pos);
+        size_t line_end = newline ? (size_t)(newline - data) : len;
+        size_t next = newline ? line_end + 1 : len;
+        size_t content_end = line_end;
+        if (content_end > pos && data[content_end - 1] == '\r') content_end--;
+
+        if (pos < content_end && (data[pos] == ' ' || data[pos] == '\t')) {
+            // 折行，延长上一个字段的值
+            if (name) value_end = content_end;
+            pos = next;
+            continue;
+        }
+
+        // 上一个字段到此结束
+        if (name) fn(name, name_len, data + value_start, value_end - value_start, arg);
+        name = NULL;
+
+        if (content_end == pos) return next;  // 空行：头块结束
+
+        const char* colon = memchr(data + pos, ':', content_end - pos);
+        if (colon) {
+            name = data + pos;
+            name_len = colon - name;
+            while (name_len > 0 && (name[name_len - 1] == ' ' || name[name_len - 1] == '\t')) name_len--;
+            value_start = colon + 1 - data;
+            while (value_start < content_end && (data[value_start] == ' ' || data[value_start] == '\t')) {
+                value_start++;
+            }
+            value_end = content_end;
+        }
+        pos = next;
+    }
+
+    if (name) fn(name, name_len, data + value_start, value_end - value_start, arg);
+    return len;
+}
+
+size_t mime_find_boundary(const char* data, size_t len, const char* boundary,
+                          int* closing, size_t* next) {
+    size_t blen = strlen(boundary);
+    size_t pos = 0;
+
+    while (pos < len) {
+        const char* newline = memchr(data + pos, '\n', len - pos);
+        size_t line_end = newline ? (size_t)(newline - data) : len;
+        size_t line_len = line_end - pos;
+        if (line_len > 0 && data[line_end - 1] == '\r') line_len--;
+
+        if (line_len >= blen + 2 && data[pos] == '-' && data[pos + 1] == '-'
+            && memcmp(data + pos + 2, boundary, blen) == 0) {
+            *closing = line_len >= blen + 4 && data[pos + blen + 2] == '-' && data[pos + blen + 3] == '-';
+            *next = newline ? line_end + 1 : len;
+            return pos;
+        }
+        pos = newline ? line_end + 1 : len;
+    }
+
+    *closing = 0;
+    *next = len;
+    return len;
+}
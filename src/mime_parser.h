@@ -0,0 +1,112 @@
+#ifndef MIME_PARSER_H
+#define MIME_PARSER_H
+
+#include <stddef.h>
+#include <openssl/evp.h>
+#include "base64.h"
+
+// 解析事件
+typedef enum {
+    MIME_HEADER,       // 邮件头字段，name为字段名，data为(已展开折行的)字段值
+    MIME_PART_HEADER,  // multipart子部分的头字段
+    MIME_TEXT,         // 第一个text/plain部分(或非multipart邮件的正文)
+    MIME_SIGNATURE,    // signature.bin附件的base64文本
+    MIME_ATTACHMENT,   // 一个附件结束，name为文件名，data为解码后内容的SHA-256摘要，
+                       // 内容不是合法的base64时len为0
+} mime_event_t;
+
+typedef void (*mime_callback_t)(mime_event_t event, const char* name,
+                                const char* data, size_t len, void* arg);
+
+// 子部分类型
+typedef enum {
+    MIME_PART_OTHER,      // 不需要的附件
+    MIME_PART_TEXT,       // text/plain正文
+    MIME_PART_SIGNATURE,  // signature.bin签名附件
+    MIME_PART_ATTACHMENT, // 带文件名的其他附件，只计算摘要，不保留内容
+} mime_part_kind_t;
+
+// 附件摘要：边解码base64边计算SHA-256，内容可以任意切块喂入
+typedef struct {
+    EVP_MD_CTX* md;  // 首次init时创建，之后的附件复用
+    base64_decoder_t decoder;
+} mime_digest_t;
+
+// 邮件头扫描回调：name/value直接指向原始数据，不以'\0'结尾，value可能含折行
+typedef void (*mime_header_fn)(const char* name, size_t name_len,
+                               const char* value, size_t value_len, void* arg);
+
+// 可增长的缓冲区
+typedef struct {
+    char* data;
+    size_t len;
+    size_t cap;
+} mime_buf_t;
+
+// 增量MIME解析器：按行驱动的状态机，数据可以任意切块喂入。
+// 只保留当前行、当前头字段和需要输出的部分，其他附件边读边丢弃
+typedef struct {
+    int state;
+    int part_kind;
+    int text_done;
+    int line_overflow;   // 被丢弃内容中的超长行，肯定不是分隔线
+    int closed;          // 已读到结束分隔线，后面不会再有子部分
+    char boundary[128];  // 不含前导"--"
+    char filename[128];  // 当前附件的文件名
+    mime_digest_t digest;  // 当前附件的摘要
+    mime_buf_t line;
+    mime_buf_t header;   // 尚未结束的头字段(可能有折行)
+    mime_buf_t part;     // 当前需要输出的部分
+    mime_callback_t callback;
+    void* arg;
+} mime_parser_t;
+
+// 单遍扫描一个头块(邮件头或子部分头)，支持折行，遇到第一个空行即停止，
+// 不会扫到正文。返回正文起点的偏移，没有空行时返回len
+size_t mime_header_scan(const char* data, size_t len, mime_header_fn fn, void* arg);
+
+// 按行查找分隔线"--boundary"，返回该行的偏移，找不到返回len。
+// closing置1表示结束分隔线"--boundary--"，next为分隔线下一行的偏移
+size_t mime_find_boundary(const char* data, size_t len, const char* boundary,
+                          int* closing, size_t* next);
+
+// 字段名比较(不区分大小写)
+int mime_name_is(const char* name, size_t name_len, const char* expected);
+
+// 展开折行，返回新分配的字符串
+char* mime_unfold(const char* value, size_t len);
+
+// 展开折行写入out(至少len+1字节)，返回写入长度
+size_t mime_unfold_to(char* out, const char* value, size_t len);
+
+// 从字段值中取参数，例如Content-Type中的boundary
+int mime_get_param(const char* value, const char* name, char* out, size_t size);
+
+// 根据一个子部分头字段判断该部分的类型，与类型无关的字段返回MIME_PART_OTHER
+mime_part_kind_t mime_classify_header(const char* name, size_t name_len,
+                                      const char* value, size_t value_len);
+
+// 开始一个附件的摘要(memset为0后可直接使用)，内存不足返回0
+int mime_digest_init(mime_digest_t* digest);
+
+// 喂入一块base64文本
+int mime_digest_update(mime_digest_t* digest, const char* data, size_t len);
+
+// 结束并写出SHA-256摘要，内容不是合法的base64返回0
+int mime_digest_final(mime_digest_t* digest, unsigned char* out, unsigned int* out_len);
+
+void mime_digest_free(mime_digest_t* digest);
+
+// 初始化解析器
+void mime_parser_init(mime_parser_t* parser, mime_callback_t callback, void* arg);
+
+// 喂入一块数据，内存不足返回0
+int mime_parser_feed(mime_parser_t* parser, const char* data, size_t len);
+
+// 数据结束，输出尚未结束的部分
+int mime_parser_finish(mime_parser_t* parser);
+
+// 释放解析器内部缓冲区
+void mime_parser_free(mime_parser_t* parser);
+
+#endif // MIME_PARSER_H
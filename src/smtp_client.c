@@ -0,0 +1,454 @@
+#include "smtp_client.h"
+#include "base64.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdarg.h>
+#include <limits.h>
+#include <ctype.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+// 等待套接字可读或可写，超时或出错返回0
+static int wait_fd(smtp_client_t* client, short events) {
+    struct pollfd pfd = { client->fd, events, 0 };
+    int n;
+    do {
+        n = poll(&pfd, 1, SMTP_CLIENT_TIMEOUT_MS);
+    } while (n < 0 && errno == EINTR);
+    return n > 0;
+}
+
+// 非阻塞TLS读写没有完成时，按OpenSSL要求的方向等待
+static int ssl_wait(smtp_client_t* client, int ret) {
+    int err = SSL_get_error(client->ssl, ret);
+    if (err == SSL_ERROR_WANT_READ) return wait_fd(client, POLLIN);
+    if (err == SSL_ERROR_WANT_WRITE) return wait_fd(client, POLLOUT);
+    return 0;
+}
+
+static int write_all(smtp_client_t* client, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t n;
+        if (client->ssl) {
+            n = SSL_write(client->ssl, data, len > INT_MAX ? INT_MAX : (int)len);
+            if (n <= 0) {
+                if (ssl_wait(client, n)) continue;
+                return 0;
+            }
+        } else {
+            n = send(client->fd, data, len, MSG_NOSIGNAL);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                if ((errno == EAGAIN || errno == EWOULDBLOCK) && wait_fd(client, POLLOUT)) continue;
+                return 0;
+            }
+        }
+        data += n;
+        len -= n;
+    }
+    return 1;
+}
+
+// 把攒下的命令一次写出
+static int flush(smtp_client_t* client) {
+    if (client->out_len == 0) return 1;
+    int ok = write_all(client, client->out, client->out_len);
+    client->out_len = 0;
+    return ok;
+}
+
+// 格式化一条命令追加到发送缓冲区
+static int queue(smtp_client_t* client, const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+static int queue(smtp_client_t* client, const char* fmt, ...) {
+    for (int attempt = 0; attempt < 2; attempt++) {
+        size_t space = sizeof(client->out) - client->out_len;
+        va_list args;
+        va_start(args, fmt);
+        int n = vsnprintf(client->out + client->out_len, space, fmt, args);
+        va_end(args);
+        if (n < 0) return 0;
+        if ((size_t)n < space) {
+            client->out_len += n;
+            return 1;
+        }
+        if (!flush(client)) return 0;
+    }
+    return 0;
+}
+
+// 追加一段数据：放得下就和命令合并成一次写，否则先写出缓冲区再直接写
+static int queue_data(smtp_client_t* client, const char* data, size_t len) {
+    if (len <= sizeof(client->out) - client->out_len) {
+        memcpy(client->out + client->out_len, data, len);
+        client->out_len += len;
+        return 1;
+    }
+    if (!flush(client)) return 0;
+    if (len <= sizeof(client->out)) return queue_data(client, data, len);
+    return write_all(client, data, len);
+}
+
+// 接收更多数据到输入缓冲区
+static int fill(smtp_client_t* client) {
+    if (client->in_start > 0) {
+        memmove(client->in, client->in + client->in_start, client->in_end - client->in_start);
+        client->in_end -= client->in_start;
+        client->in_start = 0;
+    }
+    if (client->in_end == sizeof(client->in)) return 0;
+
+    // 流水线的回复可能被服务器分成几段发出，开着Nagle的服务器要等前一段的ACK才发下一段，
+    // 立即确认避免每批命令多等一个延迟ACK(约40ms)
+    int one = 1;
+    setsockopt(client->fd, IPPROTO_TCP, TCP_QUICKACK, &one, sizeof(one));
+
+    for (;;) {
+        ssize_t n;
+        char* buf = client->in + client->in_end;
+        size_t space = sizeof(client->in) - client->in_end;
+        if (client->ssl) {
+            n = SSL_read(client->ssl, buf, (int)space);
+            if (n <= 0) {
+                if (ssl_wait(client, n)) continue;
+                return 0;
+            }
+        } else {
+            n = recv(client->fd, buf, space, 0);
+            if (n == 0) return 0;
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                if ((errno == EAGAIN || errno == EWOULDBLOCK) && wait_fd(client, POLLIN)) continue;
+                return 0;
+            }
+        }
+        client->in_end += n;
+        return 1;
+    }
+}
+
+// 读一行回复(去掉CRLF)，连接断开返回NULL
+static char* read_line(smtp_client_t* client) {
+    for (;;) {
+        char* start = client->in + client->in_start;
+        char* lf = memchr(start, '\n', client->in_end - client->in_start);
+        if (lf) {
+            client->in_start = lf + 1 - client->in;
+            if (lf > start && lf[-1] == '\r') lf--;
+            *lf = '\0';
+            return start;
+        }
+        if (!fill(client)) return NULL;
+    }
+}
+
+// 读一条(可能多行的)回复，返回回复码，出错返回-1。ehlo非0时记录通告的扩展
+static int read_reply(smtp_client_t* client, int ehlo) {
+    // 命令还在缓冲区里就先发出去，否则会一直等不到回复
+    if (!flush(client)) return client->reply_code = -1;
+    if (client->in_start == client->in_end) client->flights++;
+
+    for (;;) {
+        char* line = read_line(client);
+        if (!line || strlen(line) < 3
+            || !isdigit((unsigned char)line[0]) || !isdigit((unsigned char)line[1]) || !isdigit((unsigned char)line[2])) {
+            return client->reply_code = -1;
+        }
+        snprintf(client->reply, sizeof(client->reply), "%s", line);
+
+        if (ehlo && line[3]) {
+            const char* keyword = line + 4;
+            if (strcasecmp(keyword, "PIPELINING") == 0) client->extensions |= SMTP_EXT_PIPELINING;
+            else if (strcasecmp(keyword, "CHUNKING") == 0) client->extensions |= SMTP_EXT_CHUNKING;
+            else if (strncasecmp(keyword, "AUTH", 4) == 0) {
+                char mechanisms[256];
+                snprintf(mechanisms, sizeof(mechanisms), " %s ", keyword + 4);
+                for (char* p = mechanisms; *p; p++) *p = toupper((unsigned char)*p);
+                if (strstr(mechanisms, " PLAIN ")) client->extensions |= SMTP_EXT_AUTH_PLAIN;
+                if (strstr(mechanisms, " LOGIN ")) client->extensions |= SMTP_EXT_AUTH_LOGIN;
+            }
+        }
+        if (line[3] != '-') break;
+    }
+    client->reply_code = (client->reply[0] - '0') * 100 + (client->reply[1] - '0') * 10 + (client->reply[2] - '0');
+    return client->reply_code;
+}
+
+// Base64编码后作为一条命令发送
+static int queue_base64(smtp_client_t* client, const char* prefix, const char* data, size_t len) {
+    char* encoded = malloc((len + 2) / 3 * 4 + 1);
+    size_t encoded_len = 0;
+    if (!encoded) return 0;
+    base64_encode((const unsigned char*)data, len, encoded, &encoded_len);
+    encoded[encoded_len] = '\0';
+    int ok = queue(client, "%s%s\r\n", prefix, encoded);
+    free(encoded);
+    return ok;
+}
+
+static int authenticate(smtp_client_t* client, const char* username, const char* password) {
+    if (client->extensions & SMTP_EXT_AUTH_PLAIN) {
+        // "\0用户名\0密码"
+        size_t user_len = strlen(username), pass_len = strlen(password);
+        char* token = malloc(user_len + pass_len + 2);
+        if (!token) return 0;
+        token[0] = '\0';
+        memcpy(token + 1, username, user_len);
+        token[user_len + 1] = '\0';
+        memcpy(token + user_len + 2, password, pass_len);
+        int ok = queue_base64(client, "AUTH PLAIN ", token, user_len + pass_len + 2);
+        free(token);
+        return ok && read_reply(client, 0) == 235;
+    }
+    if (client->extensions & SMTP_EXT_AUTH_LOGIN) {
+        return queue(client, "AUTH LOGIN\r\n") && read_reply(client, 0) == 334
+            && queue_base64(client, "", username, strlen(username)) && read_reply(client, 0) == 334
+            && queue_base64(client, "", password, strlen(password)) && read_reply(client, 0) == 235;
+    }
+    // 服务器没有通告AUTH时和libcurl一样不登录
+    return 1;
+}
+
+// 非阻塞连接，超时返回0
+static int connect_socket(smtp_client_t* client, const char* host, int port) {
+    char service[16];
+    struct addrinfo hints, *list = NULL;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    snprintf(service, sizeof(service), "%d", port);
+    if (getaddrinfo(host, service, &hints, &list) != 0) return 0;
+
+    for (struct addrinfo* ai = list; ai; ai = ai->ai_next) {
+        client->fd = socket(ai->ai_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (client->fd < 0) continue;
+
+        int err = 0;
+        socklen_t err_len = sizeof(err);
+        if (connect(client->fd, ai->ai_addr, ai->ai_addrlen) == 0
+            || (errno == EINPROGRESS && wait_fd(client, POLLOUT)
+                && getsockopt(client->fd, SOL_SOCKET, SO_ERROR, &err, &err_len) == 0 && err == 0)) {
+            break;
+        }
+        close(client->fd);
+        client->fd = -1;
+    }
+    freeaddrinfo(list);
+    if (client->fd < 0) return 0;
+
+    int one = 1;
+    setsockopt(client->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return 1;
+}
+
+// 隐式TLS(smtps)握手，校验证书链和主机名
+static int start_tls(smtp_client_t* client, const char* host) {
+    client->ctx = SSL_CTX_new(TLS_client_method());
+    if (!client->ctx) return 0;
+    SSL_CTX_set_default_verify_paths(client->ctx);
+    SSL_CTX_set_verify(client->ctx, SSL_VERIFY_PEER, NULL);
+
+    client->ssl = SSL_new(client->ctx);
+    if (!client->ssl
+        || !SSL_set_fd(client->ssl, client->fd)
+        || !SSL_set_tlsext_host_name(client->ssl, host)
+        || !SSL_set1_host(client->ssl, host)) {
+        return 0;
+    }
+
+    int ret;
+    while ((ret = SSL_connect(client->ssl)) != 1) {
+        if (!ssl_wait(client, ret)) return 0;
+    }
+    return 1;
+}
+
+smtp_client_t* smtp_client_connect(const mail_config_t* config, int extensions_mask) {
+    smtp_client_t* client = calloc(1, sizeof(smtp_client_t));
+    if (!client) return NULL;
+    client->fd = -1;
+
+    int ok = connect_socket(client, config->smtp_server, config->port)
+          && (!config->use_ssl || start_tls(client, config->smtp_server))
+          && read_reply(client, 0) == 220
+          && queue(client, "EHLO crymail\r\n");
+    if (ok && read_reply(client, 1) != 250) {
+        // 不支持ESMTP的服务器退回HELO，没有任何扩展
+        client->extensions = 0;
+        ok = client->reply_code > 0 && queue(client, "HELO crymail\r\n") && read_reply(client, 0) == 250;
+    }
+    client->extensions &= extensions_mask;
+    if (ok && config->username && *config->username) {
+        ok = authenticate(client, config->username, config->password ? config->password : "");
+    }
+
+    if (!ok) {
+        if (client->reply_code > 0) fprintf(stderr, "SMTP握手失败: %s\n", client->reply);
+        smtp_client_close(client);
+        return NULL;
+    }
+    return client;
+}
+
+// 从邮件中读出正好len字节
+static int read_exact(mime_builder_t* mime, char* out, size_t len) {
+    while (len > 0) {
+        size_t n = mime_builder_read(mime, out, len);
+        if (n == 0) return 0;
+        out += n;
+        len -= n;
+    }
+    return 1;
+}
+
+// 用BDAT发送正文的下一块，不需要点填充；*remaining减到0时这一块带LAST
+static int queue_bdat(smtp_client_t* client, mime_builder_t* mime, char* chunk, size_t* remaining) {
+    size_t n = *remaining < SMTP_BDAT_CHUNK ? *remaining : SMTP_BDAT_CHUNK;
+    *remaining -= n;
+    return read_exact(mime, chunk, n)
+        && queue(client, "BDAT %zu%s\r\n", n, *remaining ? "" : " LAST")
+        && queue_data(client, chunk, n);
+}
+
+// 用DATA发送正文：行首的'.'加倍，最后以"."行结束
+static int send_data(smtp_client_t* client, mime_builder_t* mime) {
+    char* buf = malloc(SMTP_BDAT_CHUNK);
+    if (!buf) return 0;
+
+    int ok = 1, line_start = 1;
+    size_t n;
+    while (ok && (n = mime_builder_read(mime, buf, SMTP_BDAT_CHUNK)) > 0) {
+        size_t start = 0;
+        for (size_t i = 0; i < n; i++) {
+            if (line_start && buf[i] == '.') {
+                ok = ok && queue_data(client, buf + start, i - start) && queue_data(client, ".", 1);
+                start = i;
+            }
+            line_start = buf[i] == '\n';
+        }
+        ok = ok && queue_data(client, buf + start, n - start);
+    }
+    free(buf);
+    // 附件读取出错时正文不完整，不能用"."把它当成整封邮件提交
+    return ok && !mime->error && queue(client, "%s.\r\n", line_start ? "" : "\r\n");
+}
+
+int smtp_client_send(smtp_client_t* client, const char* from,
+                     char* const* recipients, size_t count,
+                     mime_builder_t* mime, int* codes) {
+    int pipelined = client->extensions & SMTP_EXT_PIPELINING;
+    int chunking = client->extensions & SMTP_EXT_CHUNKING;
+    int rset = client->need_rset;
+    int mail_code = 0;
+    size_t accepted = 0;
+
+    // 事务中途失败时下一封邮件前先RSET，成功后再清除
+    client->need_rset = 1;
+    if (rset && !(queue(client, "RSET\r\n") && (pipelined || read_reply(client, 0) > 0))) return -1;
+
+    // 不支持PIPELINING时逐条命令等回复
+    if (!queue(client, "MAIL FROM:<%s>\r\n", from)) return -1;
+    if (!pipelined) {
+        mail_code = read_reply(client, 0);
+        if (mail_code < 0 || mail_code == 421) return -1;
+        if (mail_code != 250) return 0;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (!queue(client, "RCPT TO:<%s>\r\n", recipients[i])) return -1;
+        if (!pipelined) {
+            codes[i] = read_reply(client, 0);
+            if (codes[i] < 0 || codes[i] == 421) return -1;
+            if (codes[i] / 100 == 2) accepted++;
+        }
+    }
+    if (!pipelined && accepted == 0) return 0;
+
+    // BDAT不等待服务器确认就可以发出，前几块和MAIL、RCPT同一批写出；未确认的块不超过
+    // SMTP_BDAT_WINDOW个，之后每读到一条回复再发一块，免得双方都在写、谁也不读(RFC 2920 3.2)。
+    // 不支持PIPELINING时每块都要等回复
+    char* chunk = NULL;
+    size_t remaining = 0;
+    long outstanding = 0, window = pipelined ? SMTP_BDAT_WINDOW : 1;
+    if (chunking) {
+        chunk = malloc(SMTP_BDAT_CHUNK);
+        if (!chunk) return -1;
+        remaining = mime->size;
+        do {
+            if (!queue_bdat(client, mime, chunk, &remaining)) {
+                free(chunk);
+                return -1;
+            }
+            outstanding++;
+        } while (remaining > 0 && outstanding < window);
+    } else if (!queue(client, "DATA\r\n")) {
+        return -1;
+    }
+
+    // 依次读回同一批命令的回复
+    if (pipelined) {
+        int lost = rset && read_reply(client, 0) < 0;
+        if (!lost) {
+            mail_code = read_reply(client, 0);
+            lost = mail_code < 0 || mail_code == 421;
+        }
+        for (size_t i = 0; !lost && i < count; i++) {
+            codes[i] = read_reply(client, 0);
+            lost = codes[i] < 0;
+            if (codes[i] / 100 == 2) accepted++;
+        }
+        if (lost) {
+            free(chunk);
+            return -1;
+        }
+    }
+
+    int final_code = 250;
+    if (chunking) {
+        // 有一块被拒绝后不再发后面的块，只读完已发出的块的回复
+        while (outstanding > 0) {
+            int code = read_reply(client, 0);
+            if (code < 0) break;
+            outstanding--;
+            if (code != 250) final_code = code;
+            if (final_code == 250 && remaining > 0) {
+                if (!queue_bdat(client, mime, chunk, &remaining)) break;
+                outstanding++;
+            }
+        }
+        free(chunk);
+        if (outstanding > 0) return -1;
+    } else {
+        int data_code = read_reply(client, 0);
+        if (data_code < 0 || data_code == 421) return -1;
+        if (data_code != 354) return 0;
+        // 没有收件人通过时服务器本应拒绝DATA，仍然给了354就发一封空邮件结束事务
+        if ((mail_code == 250 && accepted > 0) ? !send_data(client, mime) : !queue(client, ".\r\n")) return -1;
+        final_code = read_reply(client, 0);
+        if (final_code < 0) return -1;
+    }
+
+    if (final_code == 421) return -1;
+    if (final_code != 250 || mail_code != 250 || accepted == 0) return 0;
+    client->need_rset = 0;
+    return 1;
+}
+
+void smtp_client_close(smtp_client_t* client) {
+    if (!client) return;
+
+    // 不等QUIT的回复，服务器收到后自己会关闭连接
+    if (client->fd >= 0 && queue(client, "QUIT\r\n")) flush(client);
+    if (client->ssl) {
+        SSL_shutdown(client->ssl);
+        SSL_free(client->ssl);
+    }
+    if (client->ctx) SSL_CTX_free(client->ctx);
+    if (client->fd >= 0) close(client->fd);
+    free(client);
+}
@@ -0,0 +1,52 @@
+#ifndef SMTP_CLIENT_H
+#define SMTP_CLIENT_H
+
+#include <stddef.h>
+#include <openssl/ssl.h>
+#include "mail.h"
+#include "mime_builder.h"
+
+#define SMTP_CLIENT_BUF 16384
+#define SMTP_CLIENT_TIMEOUT_MS 60000  // 单次等待服务器的超时
+#define SMTP_BDAT_CHUNK 65536         // 每个BDAT块的字节数
+#define SMTP_BDAT_WINDOW 4            // 流水线上已发出、还没读到回复的BDAT块数上限
+
+// 服务器在EHLO中通告的扩展
+#define SMTP_EXT_PIPELINING 0x1  // RFC 2920
+#define SMTP_EXT_CHUNKING   0x2  // RFC 3030
+#define SMTP_EXT_AUTH_PLAIN 0x4
+#define SMTP_EXT_AUTH_LOGIN 0x8
+
+// 不经过libcurl的SMTP会话：非阻塞套接字(可选OpenSSL隐式TLS)，命令先攒进发送缓冲区，
+// 一次写出后再依次读取回复。服务器支持PIPELINING时MAIL FROM、全部RCPT和DATA/BDAT
+// 在同一批发出，支持CHUNKING时正文按块用BDAT流式发送，不做点填充也不等354，
+// 不超过SMTP_BDAT_WINDOW块的邮件只需一次往返
+typedef struct {
+    int fd;
+    SSL_CTX* ctx;
+    SSL* ssl;
+    int extensions;       // SMTP_EXT_*
+    int need_rset;        // 上一个事务失败，下一批命令前先RSET
+    size_t flights;       // 写出一批命令后等待回复的次数，即网络往返数
+    char in[SMTP_CLIENT_BUF];
+    size_t in_start, in_end;
+    char out[SMTP_CLIENT_BUF];
+    size_t out_len;
+    int reply_code;       // 最近一条回复
+    char reply[512];
+} smtp_client_t;
+
+// 连接、握手、EHLO并登录，失败返回NULL。extensions_mask用来屏蔽服务器通告的扩展(测试逐条模式)
+smtp_client_t* smtp_client_connect(const mail_config_t* config, int extensions_mask);
+
+// 发送一封邮件给count个收件人，codes[i]为第i个收件人的RCPT回复码。
+// 返回1表示服务器接受了邮件(至少一个收件人通过)，0表示事务被拒绝，
+// -1表示连接出错，会话不能再用
+int smtp_client_send(smtp_client_t* client, const char* from,
+                     char* const* recipients, size_t count,
+                     mime_builder_t* mime, int* codes);
+
+// 发送QUIT并关闭连接
+void smtp_client_close(smtp_client_t* client);
+
+#endif // SMTP_CLIENT_H
@@ -0,0 +1,56 @@
+#include "thread_pool.h"
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#define MAX_POOL_THREADS 256
+
+typedef struct {
+    size_t count;
+    size_t next;  // 下一个待领取的任务项，原子递增
+    const thread_pool_job_t* job;
+    void* arg;
+} pool_state_t;
+
+static void* pool_worker(void* data) {
+    pool_state_t* pool = (pool_state_t*)data;
+    const thread_pool_job_t* job = pool->job;
+    void* state = job->thread_init ? job->thread_init(pool->arg) : NULL;
+
+    for (;;) {
+        size_t index = __atomic_fetch_add(&pool->next, 1, __ATOMIC_RELAXED);
+        if (index >= pool->count) break;
+        job->run(index, state, pool->arg);
+    }
+
+    if (job->thread_done) job->thread_done(state, pool->arg);
+    return NULL;
+}
+
+int thread_pool_default_threads(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+}
+
+void thread_pool_run(size_t count, int threads, const thread_pool_job_t* job, void* arg) {
+    if (count == 0) return;
+    if (threads <= 0) threads = thread_pool_default_threads();
+    if (threads > MAX_POOL_THREADS) threads = MAX_POOL_THREADS;
+    if ((size_t)threads > count) threads = (int)count;
+
+    pool_state_t pool = { count, 0, job, arg };
+
+    // 调用线程自己也作为一个工作线程
+    pthread_t workers[MAX_POOL_THREADS];
+    int started = 0;
+    while (started < threads - 1) {
+        if (pthread_create(&workers[started], NULL, pool_worker, &pool) != 0) break;
+        started++;
+    }
+
+    pool_worker(&pool);
+
+    for (int i = 0; i < started; i++) {
+        pthread_join(workers[i], NULL);
+    }
+}
@@ -0,0 +1,24 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <stddef.h>
+
+// 批处理任务：count个相互独立的任务项分给一组工作线程，
+// 线程从共享计数器领取下一项，负载不均时也不会有线程空等
+typedef struct {
+    // 每个线程开始时调用一次，返回该线程私有的状态(例如EVP_MD_CTX)，可以为NULL
+    void* (*thread_init)(void* arg);
+    // 处理第index项
+    void (*run)(size_t index, void* state, void* arg);
+    // 线程结束时释放私有状态，可以为NULL
+    void (*thread_done)(void* state, void* arg);
+} thread_pool_job_t;
+
+// 在线程中处理全部任务项，返回时所有项都已处理完成。
+// threads<=0时使用在线CPU数；线程创建失败时剩余的项由调用线程处理
+void thread_pool_run(size_t count, int threads, const thread_pool_job_t* job, void* arg);
+
+// 在线CPU数
+int thread_pool_default_threads(void);
+
+#endif // THREAD_POOL_H
@@ -0,0 +1,222 @@
+#include "verify_cache.h"
+#include "mail.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <openssl/x509.h>
+
+#define CACHE_MAGIC "CRYVC1"
+
+// 缓存文件头，记录从其后开始
+typedef struct {
+    char magic[8];
+    uint32_t record_size;
+    uint32_t reserved;
+} verify_cache_header_t;
+
+#define ENTRY_KEY_LEN (VERIFY_CACHE_ID_LEN * 4 + 1)
+
+// 哈希表键：邮件标识和公钥指纹的十六进制
+static void entry_key(const unsigned char* id, const unsigned char* fingerprint, char* key) {
+    static const char digits[] = "0123456789abcdef";
+    for (int i = 0; i < VERIFY_CACHE_ID_LEN * 2; i++) {
+        unsigned char c = i < VERIFY_CACHE_ID_LEN ? id[i] : fingerprint[i - VERIFY_CACHE_ID_LEN];
+        key[i * 2] = digits[c >> 4];
+        key[i * 2 + 1] = digits[c & 0xF];
+    }
+    key[ENTRY_KEY_LEN - 1] = '\0';
+}
+
+int verify_cache_fingerprint(EVP_PKEY* pkey, unsigned char fingerprint[VERIFY_CACHE_ID_LEN]) {
+    unsigned char* der = NULL;
+    int der_len = i2d_PUBKEY(pkey, &der);
+    if (der_len <= 0) return 0;
+
+    unsigned int len = 0;
+    int ok = EVP_Digest(der, der_len, fingerprint, &len, EVP_sha256(), NULL)
+          && len == VERIFY_CACHE_ID_LEN;
+    OPENSSL_free(der);
+    return ok;
+}
+
+static int write_header(int fd) {
+    verify_cache_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.record_size = sizeof(verify_cache_record_t);
+    return write(fd, &header, sizeof(header)) == sizeof(header);
+}
+
+// 读取全部记录，去掉重复的，返回读到的记录总数；文件头不对时返回-1。
+// 末尾有不完整的记录时*torn为1
+static long load_records(verify_cache_t* cache, int fd, verify_cache_record_t** live, size_t* live_count,
+                         int* torn) {
+    verify_cache_header_t header;
+    ssize_t n = pread(fd, &header, sizeof(header), 0);
+    if (n == 0) return 0;
+    if (n != sizeof(header)
+        || memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0
+        || header.record_size != sizeof(verify_cache_record_t)) {
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) return -1;
+    size_t total = (st.st_size - sizeof(header)) / sizeof(verify_cache_record_t);
+    *torn = (st.st_size - sizeof(header)) % sizeof(verify_cache_record_t) != 0;
+    verify_cache_record_t* records = malloc((total ? total : 1) * sizeof(verify_cache_record_t));
+    if (!records) return -1;
+
+    // 末尾不完整的记录(写入时被中断)不读，打开时重写文件把它去掉
+    size_t bytes = total * sizeof(verify_cache_record_t);
+    if (pread(fd, records, bytes, sizeof(header)) != (ssize_t)bytes) {
+        free(records);
+        return -1;
+    }
+
+    char key[ENTRY_KEY_LEN];
+    size_t kept = 0;
+    for (size_t i = 0; i < total; i++) {
+        entry_key(records[i].id, records[i].fingerprint, key);
+        if (hashmap_contains(cache->entries, key)) continue;
+        hashmap_put(cache->entries, key, (void*)(intptr_t)records[i].status);
+        records[kept++] = records[i];
+    }
+
+    *live = records;
+    *live_count = kept;
+    return (long)total;
+}
+
+// 用有效记录重写缓存文件：先写临时文件再rename，中途失败不会破坏原文件
+static int rewrite_cache(const char* cache_file, const verify_cache_record_t* records, size_t count) {
+    char tmp_file[512];
+    snprintf(tmp_file, sizeof(tmp_file), "%s.tmp", cache_file);
+
+    int fd = open(tmp_file, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) return 0;
+
+    size_t bytes = count * sizeof(verify_cache_record_t);
+    int ok = write_header(fd) && write(fd, records, bytes) == (ssize_t)bytes;
+    if (close(fd) != 0) ok = 0;
+    if (ok) ok = rename(tmp_file, cache_file) == 0;
+    if (!ok) unlink(tmp_file);
+    return ok;
+}
+
+verify_cache_t* verify_cache_open(const char* cache_file) {
+    verify_cache_t* cache = malloc(sizeof(verify_cache_t));
+    if (!cache) return NULL;
+
+    cache->fd = -1;
+    cache->hits = 0;
+    cache->misses = 0;
+    cache->entries = hashmap_new(1024);
+    if (!cache->entries) {
+        free(cache);
+        return NULL;
+    }
+    pthread_mutex_init(&cache->lock, NULL);
+
+    int fd = open(cache_file, O_RDONLY);
+    if (fd >= 0) {
+        verify_cache_record_t* live = NULL;
+        size_t live_count = 0;
+        int torn = 0;
+        long total = load_records(cache, fd, &live, &live_count, &torn);
+        close(fd);
+
+        // 文件损坏、末尾有半条记录或有重复记录时压缩重写。半条记录没能去掉时不能再追加，
+        // 否则之后的记录都错位
+        int ok = 1;
+        if (total < 0 || torn || (size_t)total != live_count) {
+            ok = rewrite_cache(cache_file, live, total < 0 ? 0 : live_count) || (total >= 0 && !torn);
+        }
+        free(live);
+        // 损坏的文件没能重写时不再往后追加，只在内存中缓存
+        if (!ok) return cache;
+    }
+
+    cache->fd = open(cache_file, O_WRONLY | O_CREAT | O_APPEND, 0600);
+    if (cache->fd >= 0 && lseek(cache->fd, 0, SEEK_END) == 0 && !write_header(cache->fd)) {
+        close(cache->fd);
+        cache->fd = -1;
+    }
+    // 无法写入时仍然可以使用已加载的结果
+    return cache;
+}
+
+int verify_cache_id(EVP_MD_CTX* md, const char* message_id,
+                    const char* body, size_t body_len,
+                    const char* signature, size_t sig_len,
+                    const char* alg, size_t alg_len,
+                    unsigned char id[VERIFY_CACHE_ID_LEN]) {
+    EVP_MD_CTX* ctx = md ? md : EVP_MD_CTX_new();
+    if (!ctx) return 0;
+
+    // 各字段前加长度，避免字段边界移动后拼出相同的输入
+    const void* parts[] = { message_id, body, signature, alg };
+    uint64_t lens[] = { message_id ? strlen(message_id) : 0, body_len, sig_len, alg_len };
+
+    unsigned int len = 0;
+    int ok = EVP_MD_CTX_reset(ctx) && EVP_DigestInit_ex(ctx, EVP_sha256(), NULL);
+    for (int i = 0; ok && i < 4; i++) {
+        ok = EVP_DigestUpdate(ctx, &lens[i], sizeof(lens[i]))
+          && (!lens[i] || EVP_DigestUpdate(ctx, parts[i], lens[i]));
+    }
+    ok = ok && EVP_DigestFinal_ex(ctx, id, &len) && len == VERIFY_CACHE_ID_LEN;
+
+    if (!md) EVP_MD_CTX_free(ctx);
+    return ok;
+}
+
+int verify_cache_get(verify_cache_t* cache, const unsigned char id[VERIFY_CACHE_ID_LEN],
+                     const unsigned char fingerprint[VERIFY_CACHE_ID_LEN]) {
+    char key[ENTRY_KEY_LEN];
+    entry_key(id, fingerprint, key);
+
+    pthread_mutex_lock(&cache->lock);
+    int status = (int)(intptr_t)hashmap_get(cache->entries, key);
+    if (status) cache->hits++;
+    else cache->misses++;
+    pthread_mutex_unlock(&cache->lock);
+
+    return status ? status : MAIL_SIG_UNCHECKED;
+}
+
+void verify_cache_put(verify_cache_t* cache, const unsigned char id[VERIFY_CACHE_ID_LEN],
+                      const unsigned char fingerprint[VERIFY_CACHE_ID_LEN], int status) {
+    // 签名解码失败、算法不符不需要公钥运算，重新判断的代价和查缓存差不多
+    if (status != MAIL_SIG_VERIFIED && status != MAIL_SIG_FAILED) return;
+
+    char key[ENTRY_KEY_LEN];
+    entry_key(id, fingerprint, key);
+
+    verify_cache_record_t record;
+    memset(&record, 0, sizeof(record));
+    memcpy(record.id, id, VERIFY_CACHE_ID_LEN);
+    memcpy(record.fingerprint, fingerprint, VERIFY_CACHE_ID_LEN);
+    record.status = status;
+
+    pthread_mutex_lock(&cache->lock);
+    if (!hashmap_contains(cache->entries, key)) {
+        hashmap_put(cache->entries, key, (void*)(intptr_t)status);
+        // O_APPEND下单条记录一次write，不会和别的进程的记录交错
+        if (cache->fd >= 0 && write(cache->fd, &record, sizeof(record)) != sizeof(record)) {
+            close(cache->fd);
+            cache->fd = -1;
+        }
+    }
+    pthread_mutex_unlock(&cache->lock);
+}
+
+void verify_cache_close(verify_cache_t* cache) {
+    if (!cache) return;
+    if (cache->fd >= 0) close(cache->fd);
+    hashmap_free(cache->entries, NULL);
+    pthread_mutex_destroy(&cache->lock);
+    free(cache);
+}
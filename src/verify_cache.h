@@ -0,0 +1,55 @@
+#ifndef VERIFY_CACHE_H
+#define VERIFY_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <openssl/evp.h>
+#include "hashmap.h"
+
+#define VERIFY_CACHE_FILE "verify.cache"
+#define VERIFY_CACHE_ID_LEN 32  // SHA-256
+
+// 定长缓存记录(72字节)
+typedef struct {
+    unsigned char id[VERIFY_CACHE_ID_LEN];           // 邮件标识，见verify_cache_id
+    unsigned char fingerprint[VERIFY_CACHE_ID_LEN];  // 验签公钥的SHA-256指纹
+    uint32_t status;                                  // MAIL_SIG_VERIFIED或MAIL_SIG_FAILED
+    uint32_t reserved;
+} verify_cache_record_t;
+
+// 持久化的验签结果缓存：按(邮件标识, 公钥指纹)查找，公钥更换后指纹不同，
+// 旧结果自然不再命中。可以被多个线程共享
+typedef struct {
+    hashmap_t* entries;  // 十六进制id+指纹 -> status
+    int fd;              // 追加写入新结果
+    pthread_mutex_t lock;
+    size_t hits;
+    size_t misses;
+} verify_cache_t;
+
+// 打开(不存在则创建)缓存文件
+verify_cache_t* verify_cache_open(const char* cache_file);
+
+// 公钥指纹：DER编码的SubjectPublicKeyInfo做SHA-256
+int verify_cache_fingerprint(EVP_PKEY* pkey, unsigned char fingerprint[VERIFY_CACHE_ID_LEN]);
+
+// 计算邮件标识：Message-ID、正文、签名和算法标记一起做SHA-256，
+// 任何一项变化都得到新的标识。md为调用者复用的上下文，为NULL时临时创建
+int verify_cache_id(EVP_MD_CTX* md, const char* message_id,
+                    const char* body, size_t body_len,
+                    const char* signature, size_t sig_len,
+                    const char* alg, size_t alg_len,
+                    unsigned char id[VERIFY_CACHE_ID_LEN]);
+
+// 查找缓存的验签结果，未命中返回MAIL_SIG_UNCHECKED
+int verify_cache_get(verify_cache_t* cache, const unsigned char id[VERIFY_CACHE_ID_LEN],
+                     const unsigned char fingerprint[VERIFY_CACHE_ID_LEN]);
+
+// 记录验签结果，只缓存需要做公钥运算才能得到的通过/失败结论
+void verify_cache_put(verify_cache_t* cache, const unsigned char id[VERIFY_CACHE_ID_LEN],
+                      const unsigned char fingerprint[VERIFY_CACHE_ID_LEN], int status);
+
+void verify_cache_close(verify_cache_t* cache);
+
+#endif // VERIFY_CACHE_H